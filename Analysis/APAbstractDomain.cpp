@@ -1,4 +1,6 @@
 #include "APAbstractDomain.h"
+#include "VariablePacks.h"
+#include "../Utils.h"
 
 #include <sstream>
 #include <map>
@@ -48,9 +50,28 @@ using namespace clang;
 namespace differential {
 
 manager * APAbstractDomain_ValueTypes::ValTy::mgr_ptr_ = 0;
+manager * APAbstractDomain_ValueTypes::ValTy::cascade_mgr_ptr_ = 0;
+
+const string & APAbstractDomain_ValueTypes::ValTy::ManagerType() {
+	if (cascade_mgr_ptr_ && mgr_ptr_ == cascade_mgr_ptr_)
+		return AnalysisConfiguration::cascade_manager_type_;
+	return AnalysisConfiguration::manager_type_;
+}
+
+const string & APAbstractDomain_ValueTypes::ValTy::ManagerType(const manager &mgr) {
+	if (cascade_mgr_ptr_ && mgr.get_ap_manager_t() == cascade_mgr_ptr_->get_ap_manager_t())
+		return AnalysisConfiguration::cascade_manager_type_;
+	return AnalysisConfiguration::manager_type_;
+}
 
 map< var,vector<var> > APAbstractDomain_ValueTypes::ValTy::read_map_;
 map< var,vector<var> > APAbstractDomain_ValueTypes::ValTy::update_map_;
+map<string,APAbstractDomain_ValueTypes::ValTy::ArrayAccesses> APAbstractDomain_ValueTypes::ValTy::read_index_;
+map<string,APAbstractDomain_ValueTypes::ValTy::ArrayAccesses> APAbstractDomain_ValueTypes::ValTy::update_index_;
+map<var,unsigned> APAbstractDomain_ValueTypes::ValTy::access_seq_;
+APAbstractDomain_ValueTypes::ValTy::DeductionCache APAbstractDomain_ValueTypes::ValTy::read_deduced_;
+APAbstractDomain_ValueTypes::ValTy::DeductionCache APAbstractDomain_ValueTypes::ValTy::update_deduced_;
+set<unsigned> APChecker::report_lines_;
 
 AnalysisConfiguration::PartitionPoint APAbstractDomain_ValueTypes::ValTy::partition_point_ = AnalysisConfiguration::PARTITION_AT_CORR_POINT;
 AnalysisConfiguration::PartitionStrategy APAbstractDomain_ValueTypes::ValTy::partition_strategy_ = AnalysisConfiguration::JOIN_EQUIV;
@@ -148,6 +169,55 @@ void APAbstractDomain_ValueTypes::ValTy::Assign(const environment& expr_env, con
 #endif
 }
 
+// assigns all targets of the given assignments in the abstract in a single parallel assignment
+static void AssignParallel(manager& mgr, abstract1& abs, const APAbstractDomain_ValueTypes::ValTy::Assignments& assignments) {
+	if (assignments.empty())
+		return;
+	environment env = abs.get_environment();
+	vector<var> variables;
+	vector<const texpr1*> exprs;
+	for (size_t i = 0; i < assignments.size(); ++i) {
+		if ( !env.contains(assignments[i].first) )
+			env = env.add(&assignments[i].first,1,0,0);
+		env = AnalysisUtils::JoinEnvironments(env,assignments[i].second.get_environment());
+		variables.push_back(assignments[i].first);
+		exprs.push_back(&assignments[i].second);
+	}
+	abs.change_environment(mgr,env);
+	abs.assign(mgr,variables,exprs);
+}
+
+void APAbstractDomain_ValueTypes::ValTy::Assign(const Assignments& assignments, const Assignments& guard_assignments) {
+	if (assignments.empty() && guard_assignments.empty())
+		return;
+#if (DEBUGAssign)
+	cerr << "Assigning in parallel " << assignments.size() << " variables and " << guard_assignments.size() << " guards\n";
+#endif
+	manager mgr = *mgr_ptr_;
+	AbstractSet updated_abs_set;
+
+	if (abs_set_.size() == 0) {
+		environment env;
+		abstract1 abs(mgr, env, apron::top()), guards(mgr, env, apron::top());
+		AssignParallel(mgr,abs,assignments);
+		AssignParallel(mgr,guards,guard_assignments);
+		if (!(abs.is_bottom(mgr) || guards.is_bottom(mgr)))
+			updated_abs_set.insert(Abstract2(abs,guards));
+	} else {
+		for ( AbstractSet::iterator iter = abs_set_.begin(), E = abs_set_.end(); iter != E; ++iter ) {
+			abstract1 abs = iter->vars, guards = iter->guards;
+			AssignParallel(mgr,abs,assignments);
+			AssignParallel(mgr,guards,guard_assignments);
+			if (!(abs.is_bottom(mgr) || guards.is_bottom(mgr)))
+				updated_abs_set.insert(Abstract2(abs,guards));
+		}
+	}
+	abs_set_ = updated_abs_set;
+#if (DEBUGAssign)
+	cerr << "Assign. " << *this << endl;
+#endif
+}
+
 /// forget given var from the state.
 void APAbstractDomain_ValueTypes::ValTy::Forget(string name) {
 	manager mgr = *mgr_ptr_;
@@ -165,6 +235,26 @@ void APAbstractDomain_ValueTypes::ValTy::Forget(string name) {
 	abs_set_ = updated_abs_set;
 }
 
+/// remove the given vars from the environments of the abstracts. guards are left untouched.
+void APAbstractDomain_ValueTypes::ValTy::Project(const vector<var> &vars) {
+	if (vars.empty())
+		return;
+	manager mgr = *mgr_ptr_;
+	AbstractSet updated_abs_set;
+	for ( AbstractSet::iterator iter = abs_set_.begin(), end = abs_set_.end(); iter != end; ++iter ) {
+		abstract1 abs = iter->vars;
+		environment env = abs.get_environment();
+		for ( unsigned i = 0 ; i < vars.size() ; ++i ) {
+			if (env.contains(vars[i]))
+				env = env.remove(&vars[i],1);
+		}
+		if (env.get_dim() != abs.get_environment().get_dim())
+			abs.change_environment(mgr,env);
+		updated_abs_set.insert(Abstract2(abs,iter->guards));
+	}
+	abs_set_ = updated_abs_set;
+}
+
 #define DEBUGAssume             0
 /// Assume set{abs1,abs2} means assume (abs1 v abs2)
 void APAbstractDomain_ValueTypes::ValTy::Assume(const set<abstract1>& added_abs_set) {
@@ -203,12 +293,36 @@ void APAbstractDomain_ValueTypes::ValTy::Assume(const set<abstract1>& added_abs_
 #endif
 }
 
+/**
+ * Abstracts are interned by their print-out, so equal abstracts are the same pointer. The fingerprint
+ * sums a hash per (vars,guards) pair, which makes it independent of the order of the set.
+ */
+uint64_t APAbstractDomain_ValueTypes::ValTy::Fingerprint() const {
+	uint64_t result = AnalysisUtils::Mix(abs_set_.size());
+	for ( AbstractSet::const_iterator iter = abs_set_.begin(), end = abs_set_.end(); iter != end; ++iter )
+		result += AnalysisUtils::Mix((uintptr_t)iter->vars.abstract() ^ AnalysisUtils::Mix((uintptr_t)iter->guards.abstract()));
+	return result;
+}
+
+bool APAbstractDomain_ValueTypes::ValTy::SameAbstracts(const ValTy& rhs) const {
+	if (size() != rhs.size())
+		return false;
+	for ( AbstractSet::const_iterator iter = abs_set_.begin(), end = abs_set_.end(), rhs_iter = rhs.abs_set_.begin(); iter != end; ++iter, ++rhs_iter ) {
+		if (iter->vars.abstract() != rhs_iter->vars.abstract() || iter->guards.abstract() != rhs_iter->guards.abstract())
+			return false;
+	}
+	return true;
+}
+
+// different fingerprints mean different interned abstracts, the set comparison only runs on a match
 bool APAbstractDomain_ValueTypes::ValTy::operator==(const ValTy& rhs) const {
 #if (DEBUGEqual)
 	cerr << "Comparing " << *this << " To " << rhs;
 #endif
-	if (size() != rhs.size())
+	if (size() != rhs.size() || Fingerprint() != rhs.Fingerprint())
 		return false;
+	if (SameAbstracts(rhs))
+		return true;
 	for ( AbstractSet::const_iterator iter = abs_set_.begin(), end = abs_set_.end(); iter != end; ++iter ) {
 		if ( rhs.abs_set_.find(*iter) == rhs.abs_set_.end() ) return false;
 	}
@@ -220,6 +334,8 @@ bool APAbstractDomain_ValueTypes::ValTy::operator<=(const ValTy& rhs) const {
 #if (DEBUGLowerEqual)
 	cerr << *this << " <= " << rhs << " ? ";
 #endif
+	if (Fingerprint() == rhs.Fingerprint() && SameAbstracts(rhs))
+		return true;
 	manager mgr = *mgr_ptr_;
 	// forall sub-states S1 in the abstract set
 	for ( AbstractSet::const_iterator iter = abs_set_.begin(), end = abs_set_.end(); iter != end; ++iter ) {
@@ -278,24 +394,22 @@ void APAbstractDomain_ValueTypes::ValTy::JoinAll() {
 }
 
 // returns a mapping: {guards} ->  [abstracts]
-map<Abstract1,AbstractSet> APAbstractDomain_ValueTypes::ValTy::PartitionByGuards() const {
-	map<Abstract1,AbstractSet> result;
+// abstracts are partitioned by their interned guards abstract, so matching guards is pointer equality
+map<const abstract1*,AbstractSet> APAbstractDomain_ValueTypes::ValTy::PartitionByGuards() const {
+	map<const abstract1*,AbstractSet> result;
 	for ( AbstractSet::const_iterator iter = abs_set_.begin(), end = abs_set_.end(); iter != end; ++iter ) {
 		Abstract2 abs2 = *iter;
-		//Abstract1 guards = (abs2.guards);
-		//guards.change_environment(*mgr_ptr_,env_);
 		// map the abstract to it's guards
-		//result[guards_str].insert(abs_ref);
-		result[abs2.guards].insert(abs2);
+		result[abs2.guards.abstract()].insert(abs2);
 #if (DEBUGPartition)
-		cerr << "Inserting " << abs2.guards << " -> " << (abs2.vars) << " Size = " << result[abs2.guards].size()  << endl;
+		cerr << "Inserting " << abs2.guards << " -> " << (abs2.vars) << endl;
 #endif
 	}
 #if (DEBUGPartition)
 	cerr << "Partition: \n";
-	for (map<Abstract1,AbstractSet>::iterator iter = result.begin(), end = result.end(); iter != end; ++iter) {
+	for (map<const abstract1*,AbstractSet>::iterator iter = result.begin(), end = result.end(); iter != end; ++iter) {
 		AbstractSet abs_set = iter->second;
-		cerr << iter->first << " -> ";
+		cerr << *iter->first << " -> ";
 		for ( AbstractSet::const_iterator iter2 = abs_set.begin(), end2 = abs_set.end(); iter2 != end2; ++iter2 )
 			cerr << (iter2->vars);
 		cerr << endl;
@@ -309,27 +423,88 @@ bool APAbstractDomain_ValueTypes::ValTy::CanBeReduced(string arr_name, string ar
 			(arr_name.find(Defines::kTagPrefix) == arr_name.npos && arr2_name.find(Defines::kTagPrefix) == arr2_name.npos) );
 }
 
+void APAbstractDomain_ValueTypes::ValTy::AddArrayAccess(map< var,vector<var> > &accesses, map<string,ArrayAccesses> &index, const var& access, const var& array, const var& idx) {
+	vector<var> vars;
+	vars.push_back(array);
+	vars.push_back(idx);
+	accesses[access] = vars;
+	if (access_seq_.count(access))
+		return;
+	unsigned seq = access_seq_.size();
+	access_seq_[access] = seq;
+	string untagged = array, tagged;
+	Utils::Names(untagged,tagged);
+	index[untagged].accesses[untagged != (string)array].push_back(access);
+}
+
+void APAbstractDomain_ValueTypes::ValTy::AddArrayRead(const var& read, const var& array, const var& index) {
+	AddArrayAccess(read_map_,read_index_,read,array,index);
+}
+
+void APAbstractDomain_ValueTypes::ValTy::AddArrayUpdate(const var& update, const var& array, const var& index) {
+	AddArrayAccess(update_map_,update_index_,update,array,index);
+}
+
+void APAbstractDomain_ValueTypes::ValTy::ClearArrayAccesses() {
+	read_map_.clear();
+	update_map_.clear();
+	read_index_.clear();
+	update_index_.clear();
+	access_seq_.clear();
+	read_deduced_.clear();
+	update_deduced_.clear();
+}
+
+// a pair of accesses needs to be checked if at least one of them was added after seq
+bool APAbstractDomain_ValueTypes::ValTy::IsNewPair(const var& access, const var& access2, unsigned seq) {
+	return access_seq_[access] >= seq || access_seq_[access2] >= seq;
+}
+
+/**
+ * Applies the rule to the abstract, reusing the previous application: the result of the rule for the accesses
+ * known at that time is extended with the pairs that involve newer accesses only.
+ */
+Abstract1 APAbstractDomain_ValueTypes::ValTy::ApplyDeductionRule(DeductionCache &cache, const Abstract1 &vars, Abstract1 (*rule)(const Abstract1&,unsigned)) {
+	unsigned seq = access_seq_.size();
+	DeductionCache::iterator iter = cache.find(vars.abstract());
+	if (iter != cache.end() && iter->second.first == seq)
+		return iter->second.second;
+	Abstract1 result = (iter == cache.end()) ? rule(vars,0) : rule(iter->second.second,iter->second.first);
+	cache[vars.abstract()] = make_pair(seq,result);
+	cache[result.abstract()] = make_pair(seq,result);
+	return result;
+}
+
 /**
  *  implement the Read-After-Update deduction rule for read(A,idx_l1):
  *  for each update(B,idx_l2) s.t. A == B and idx_l1 == idx_l2 in state:
  *  state = (state /\ {read(A,idx_l1) == update(B,idx_l2)}) \ { read(A,idx_l1) }
+ *  only the updates of A (in either version) are candidates.
  */
 void APAbstractDomain_ValueTypes::ValTy::ApplyArrayReadAfterUpdateDeductionRule(var read_var)  {
 	if (!update_map_.size())
 		return;
 	manager mgr = *mgr_ptr_;
-	AbstractSet deduced_set;
 	const vector<var> &read = read_map_[read_var];
+	string untagged = read[0], tagged;
+	Utils::Names(untagged,tagged);
+	map<string,ArrayAccesses>::const_iterator index_iter = update_index_.find(untagged);
+	if (index_iter == update_index_.end())
+		return;
+	AbstractSet deduced_set;
 	for ( AbstractSet::iterator iter = abs_set_.begin(), end = abs_set_.end(); iter != end; ++iter ) {
 		abstract1 abs = iter->vars;
 		const environment& env = abs.get_environment();
-		for (map< var, vector<var> >::const_iterator update_iter = update_map_.begin(), end = update_map_.end(); update_iter != end; ++update_iter) {
-			const vector<var> &update = update_iter->second;
-			if (AnalysisUtils::IsEquivalent(abs, read[0], update[0]) && // A == B
-					AnalysisUtils::IsEquivalent(abs, read[1], update[1])) { //  idx_l1 == idx_l2
-				tcons1 constraint = (texpr1(env, read_var) == texpr1(env, update_iter->first)); //  read(A,idx_l1) == update(B,idx_l2)
-				abs = abs.meet(mgr, tcons1_array(1, &constraint));
-				abs = abs.forget(mgr,read_var);
+		for (unsigned version = 0; version < 2; ++version) {
+			const vector<var> &updates = index_iter->second.accesses[version];
+			for (unsigned i = 0; i < updates.size(); ++i) {
+				const vector<var> &update = update_map_[updates[i]];
+				if (AnalysisUtils::IsEquivalent(abs, read[0], update[0]) && // A == B
+						AnalysisUtils::IsEquivalent(abs, read[1], update[1])) { //  idx_l1 == idx_l2
+					tcons1 constraint = (texpr1(env, read_var) == texpr1(env, updates[i])); //  read(A,idx_l1) == update(B,idx_l2)
+					abs = abs.meet(mgr, tcons1_array(1, &constraint));
+					abs = abs.forget(mgr,read_var);
+				}
 			}
 		}
 		deduced_set.insert(Abstract2(abs,iter->guards));
@@ -341,32 +516,36 @@ void APAbstractDomain_ValueTypes::ValTy::ApplyArrayReadAfterUpdateDeductionRule(
  *  implement the READ deduction rule:
  *  start by calculating read(A,idx_l1), read(B',idx_l2') equivalence
  *  if A = B' and idx_l1 = idx_l2' then read(A,idx_l1) = read(B',idx_l2')
+ *  a read from P can only be reduced by a read from P' of the same array, and vice versa.
  */
-void APAbstractDomain_ValueTypes::ValTy::ApplyArrayReadDeductionRule()  {
-	if (!read_map_.size())
-		return;
+Abstract1 APAbstractDomain_ValueTypes::ValTy::ApplyArrayReadDeductionRule(const Abstract1 &vars, unsigned seq)  {
 	manager mgr = *mgr_ptr_;
-	AbstractSet deduced_set;
-	for ( AbstractSet::iterator iter = abs_set_.begin(), end = abs_set_.end(); iter != end; ++iter ) {
-		abstract1 abs = iter->vars;
-		const environment& env = abs.get_environment();
-		for (map< var, vector<var> >::const_iterator read_iter = read_map_.begin(), end = read_map_.end(); read_iter != end; ++read_iter) {
-			map< var, vector<var> >::const_iterator read2_iter = read_iter;
-			while (++read2_iter != end) {
-				// for every (different) pair of reads
-				const vector<var> &read = read_iter->second, &read2 = read2_iter->second;
-				// a read from P can only be reduced by a read from P' and vice versa
-				if (!CanBeReduced(read[0],read2[0]))
+	abstract1 abs = vars;
+	const environment& env = abs.get_environment();
+	for (map<string,ArrayAccesses>::const_iterator index_iter = read_index_.begin(), index_end = read_index_.end(); index_iter != index_end; ++index_iter) {
+		const vector<var> &reads = index_iter->second.accesses[0], &reads2 = index_iter->second.accesses[1];
+		for (unsigned i = 0; i < reads.size(); ++i) {
+			for (unsigned j = 0; j < reads2.size(); ++j) {
+				if (!IsNewPair(reads[i],reads2[j],seq))
 					continue;
+				const vector<var> &read = read_map_[reads[i]], &read2 = read_map_[reads2[j]];
 				if (AnalysisUtils::IsEquivalent(abs, read[0], read2[0]) && 		// A == B'
 						AnalysisUtils::IsEquivalent(abs, read[1], read2[1])) {	// idx_l1 == idx_l2'
-					tcons1 constraint = (texpr1(env, read_iter->first) == texpr1(env, read2_iter->first));
+					tcons1 constraint = (texpr1(env, reads[i]) == texpr1(env, reads2[j]));
 					abs = abs.meet(mgr, tcons1_array(1, &constraint));
 				}
 			}
 		}
-		deduced_set.insert(Abstract2(abs,iter->guards));
 	}
+	return Abstract1(abs);
+}
+
+void APAbstractDomain_ValueTypes::ValTy::ApplyArrayReadDeductionRule()  {
+	if (!read_map_.size())
+		return;
+	AbstractSet deduced_set;
+	for ( AbstractSet::iterator iter = abs_set_.begin(), end = abs_set_.end(); iter != end; ++iter )
+		deduced_set.insert(Abstract2(ApplyDeductionRule(read_deduced_,iter->vars,&ApplyArrayReadDeductionRule),iter->guards));
 	abs_set_ = deduced_set;
 }
 
@@ -376,35 +555,41 @@ void APAbstractDomain_ValueTypes::ValTy::ApplyArrayReadDeductionRule()  {
  *  if A = B', idx_l1 = idx_l2' and update(A,idx_l1) = update(B',idx_l2') then both updates can be forgotten
  *  if the state has an unmatched update(), it means no equivalence
  */
-void APAbstractDomain_ValueTypes::ValTy::ApplyArrayUpdateDeductionRule()  {
-	if (!update_map_.size())
-		return;
+Abstract1 APAbstractDomain_ValueTypes::ValTy::ApplyArrayUpdateDeductionRule(const Abstract1 &vars, unsigned seq)  {
 	manager mgr = *mgr_ptr_;
-	AbstractSet deduced_set;
-	for ( AbstractSet::iterator iter = abs_set_.begin(), end = abs_set_.end(); iter != end; ++iter ) {
-		abstract1 abs = iter->vars;
-		vector<var> equiv_updates;
-		for (map< var, vector<var> >::const_iterator updates_iter = update_map_.begin(), end = update_map_.end(); updates_iter != end; ++updates_iter) {
-			map< var, vector<var> >::const_iterator updates2_iter = updates_iter;
-			while (++updates2_iter != end) {
-				// for every (different) pair of updates
-				const vector<var> &update = updates_iter->second, &update2 = updates2_iter->second;
-				// an update from P can only be reduced by an update from P' and vice versa
-				if (!CanBeReduced(update[0],update2[0]))
+	abstract1 abs = vars;
+	set<var> equiv_updates;
+	for (map<string,ArrayAccesses>::const_iterator index_iter = update_index_.begin(), index_end = update_index_.end(); index_iter != index_end; ++index_iter) {
+		const vector<var> &updates = index_iter->second.accesses[0], &updates2 = index_iter->second.accesses[1];
+		for (unsigned i = 0; i < updates.size(); ++i) {
+			for (unsigned j = 0; j < updates2.size(); ++j) {
+				if (!IsNewPair(updates[i],updates2[j],seq))
 					continue;
-				if (AnalysisUtils::IsEquivalent(abs, updates_iter->first, updates2_iter->first) && // update(A,idx_l1) == update(B,idx_l2),
+				const vector<var> &update = update_map_[updates[i]], &update2 = update_map_[updates2[j]];
+				if (AnalysisUtils::IsEquivalent(abs, updates[i], updates2[j]) && // update(A,idx_l1) == update(B,idx_l2),
 						AnalysisUtils::IsEquivalent(abs, update[0], update2[0]) && 	// A == B
 						AnalysisUtils::IsEquivalent(abs, update[1], update2[1])) {	// idx_l1 == idx_l2
-					equiv_updates.push_back(updates_iter->first);
-					equiv_updates.push_back(updates2_iter->first);
+					equiv_updates.insert(updates[i]);
+					equiv_updates.insert(updates2[j]);
 				}
 			}
 		}
-		environment env = abs.get_environment().remove(equiv_updates);
-		abs = abs.forget(mgr,equiv_updates);
-		abs = abs.change_environment(mgr,env);
-		deduced_set.insert(Abstract2(abs,iter->guards));
 	}
+	if (equiv_updates.empty())
+		return vars;
+	vector<var> removed(equiv_updates.begin(),equiv_updates.end());
+	environment env = abs.get_environment().remove(removed);
+	abs = abs.forget(mgr,removed);
+	abs = abs.change_environment(mgr,env);
+	return Abstract1(abs);
+}
+
+void APAbstractDomain_ValueTypes::ValTy::ApplyArrayUpdateDeductionRule()  {
+	if (!update_map_.size())
+		return;
+	AbstractSet deduced_set;
+	for ( AbstractSet::iterator iter = abs_set_.begin(), end = abs_set_.end(); iter != end; ++iter )
+		deduced_set.insert(Abstract2(ApplyDeductionRule(update_deduced_,iter->vars,&ApplyArrayUpdateDeductionRule),iter->guards));
 	abs_set_ = deduced_set;
 }
 
@@ -502,19 +687,17 @@ map<set<var>,Abstract2> APAbstractDomain_ValueTypes::ValTy::JoinByPartition(map<
 	return result;
 }
 
-map<Abstract1,Abstract1> APAbstractDomain_ValueTypes::ValTy::JoinByPartition(map<Abstract1,AbstractSet> partition) {
-	map<Abstract1,Abstract1> result;
+map<const abstract1*,Abstract2> APAbstractDomain_ValueTypes::ValTy::JoinByPartition(map<const abstract1*,AbstractSet> partition) {
+	map<const abstract1*,Abstract2> result;
 	manager mgr = *mgr_ptr_;
 #if (DEBUGPartition)
 	cerr << "JoinByPartition: \n";
 #endif
-	for (map<Abstract1,AbstractSet>::const_iterator iter = partition.begin(), end = partition.end(); iter != end; ++iter ) {
-		// for each set of abstracts (that have the same guards abstract) join them all into one abstract and put it in the result
-		Abstract1 guards = iter->first;
-		Abstract2 joined = AnalysisUtils::JoinAbstracts(mgr,iter->second);
-		result[guards] = joined.vars;
+	for (map<const abstract1*,AbstractSet>::const_iterator iter = partition.begin(), end = partition.end(); iter != end; ++iter ) {
+		// for each set of abstracts (that have the same guards) join them all into one abstract and put it in the result
+		result[iter->first] = AnalysisUtils::JoinAbstracts(mgr,iter->second);
 #if (DEBUGPartition)
-		cerr << guards << " -> " << result[guards] << endl;
+		cerr << result[iter->first] << endl;
 #endif
 	}
 	return result;
@@ -530,11 +713,11 @@ AbstractSet APAbstractDomain_ValueTypes::ValTy::PartitionToAbsSet(map<set<var>,A
 	return result;
 }
 
-AbstractSet APAbstractDomain_ValueTypes::ValTy::PartitionToAbsSet(map<Abstract1,Abstract1> partition) {
+AbstractSet APAbstractDomain_ValueTypes::ValTy::PartitionToAbsSet(map<const abstract1*,Abstract2> partition) {
 	AbstractSet result;
-	for (map<Abstract1,Abstract1>::const_iterator partition_iter = partition.begin(), partition_end = partition.end(); partition_iter != partition_end; ++partition_iter ) {
+	for (map<const abstract1*,Abstract2>::const_iterator partition_iter = partition.begin(), partition_end = partition.end(); partition_iter != partition_end; ++partition_iter ) {
 		// place the abstracts into a regular abstract set
-		result.insert(Abstract2(partition_iter->second,partition_iter->first));
+		result.insert(partition_iter->second);
 	}
 	return result;
 }
@@ -619,22 +802,41 @@ APAbstractDomain_ValueTypes::ValTy& APAbstractDomain_ValueTypes::ValTy::Meet(con
 	if (abs_set_.size() == 0) {
 		met_abs_set = rhs.abs_set_;
 	} else {
-		for ( AbstractSet::const_iterator iter = abs_set_.begin(), end = abs_set_.end(); iter != end; ++iter ) {
-			for ( AbstractSet::const_iterator rhs_iter = rhs.abs_set_.begin(), rhs_end = rhs.abs_set_.end(); rhs_iter != rhs_end; ++rhs_iter ) {
-				abstract1 rhs_abs = (rhs_iter->vars), meet_abs = (iter->vars);
-				abstract1 rhs_guards = (rhs_iter->guards), meet_guards = (iter->guards);
-				// abstarcts
-				environment env = AnalysisUtils::JoinEnvironments(meet_abs.get_environment(),rhs_abs.get_environment());
-				meet_abs.change_environment(mgr,env);
-				rhs_abs.change_environment(mgr,env);
-				meet_abs.meet(mgr,rhs_abs);
-				// guards
-				env = AnalysisUtils::JoinEnvironments(meet_guards.get_environment(),rhs_guards.get_environment());
-				meet_guards.change_environment(mgr,env);
-				rhs_guards.change_environment(mgr,env);
-				meet_guards.meet(mgr,rhs_guards);
-				if (!(meet_abs.is_bottom(mgr) || meet_guards.is_bottom(mgr)))
-					met_abs_set.insert(Abstract2((meet_abs),(meet_guards)));
+		// bucket both sides by guards, pairs of buckets whose guards' BDDs contradict are skipped altogether.
+		// the BDDs only hold the 0/1 valuations, so this is not what the apron meet would give: g+h=1 and g=h
+		// have no 0/1 solution, but meet to the (rational) point g=h=1/2. guards are booleans, so dropping
+		// such pairs is sound for the program, it is just more precise than meeting the polyhedra.
+		map<const abstract1*,AbstractSet> partition = PartitionByGuards(), rhs_partition = rhs.PartitionByGuards();
+		// guards are shared by many disjuncts, meet each pair of guards once (a NULL result means bottom)
+		map<pair<const abstract1*,const abstract1*>,const abstract1*> met_guards;
+		for (map<const abstract1*,AbstractSet>::const_iterator bucket = partition.begin(), bucket_end = partition.end(); bucket != bucket_end; ++bucket) {
+			for (map<const abstract1*,AbstractSet>::const_iterator rhs_bucket = rhs_partition.begin(), rhs_bucket_end = rhs_partition.end(); rhs_bucket != rhs_bucket_end; ++rhs_bucket) {
+				if (GuardBDD::And(GuardBDD::FromAbstract(Abstract1(bucket->first)),GuardBDD::FromAbstract(Abstract1(rhs_bucket->first))) == GuardBDD::kFalse)
+					continue;
+				for ( AbstractSet::const_iterator iter = bucket->second.begin(), end = bucket->second.end(); iter != end; ++iter ) {
+					for ( AbstractSet::const_iterator rhs_iter = rhs_bucket->second.begin(), rhs_end = rhs_bucket->second.end(); rhs_iter != rhs_end; ++rhs_iter ) {
+						// guards first, they are cheaper than the variables
+						pair<const abstract1*,const abstract1*> guards_key(iter->guards.abstract(),rhs_iter->guards.abstract());
+						if (!met_guards.count(guards_key)) {
+							abstract1 rhs_guards = (rhs_iter->guards), meet_guards = (iter->guards);
+							environment env = AnalysisUtils::JoinEnvironments(meet_guards.get_environment(),rhs_guards.get_environment());
+							meet_guards.change_environment(mgr,env);
+							rhs_guards.change_environment(mgr,env);
+							meet_guards.meet(mgr,rhs_guards);
+							met_guards[guards_key] = meet_guards.is_bottom(mgr) ? NULL : Abstract1(meet_guards).abstract();
+						}
+						if (!met_guards[guards_key])
+							continue;
+						// abstarcts
+						abstract1 rhs_abs = (rhs_iter->vars), meet_abs = (iter->vars);
+						environment env = AnalysisUtils::JoinEnvironments(meet_abs.get_environment(),rhs_abs.get_environment());
+						meet_abs.change_environment(mgr,env);
+						rhs_abs.change_environment(mgr,env);
+						meet_abs.meet(mgr,rhs_abs);
+						if (!meet_abs.is_bottom(mgr))
+							met_abs_set.insert(Abstract2((meet_abs),Abstract1(met_guards[guards_key])));
+					}
+				}
 			}
 		}
 	}
@@ -665,14 +867,27 @@ APAbstractDomain_ValueTypes::ValTy& APAbstractDomain_ValueTypes::ValTy::MeetGuar
 	if (abs_set_.size() == 0) {
 		met_abs_set.insert(Abstract2((abstract1(*mgr_ptr_,guard_abs.get_environment(),apron::top())),(guard_abs)));
 	} else {
+		GuardBDD::Ref guard_bdd = GuardBDD::FromAbstract(guard_abs);
+		// disjuncts share guards, meet each guards abstract once (a NULL result means bottom)
+		map<const abstract1*,const abstract1*> met_guards;
 		for ( AbstractSet::const_iterator iter = abs_set_.begin(), end = abs_set_.end(); iter != end; ++iter ) {
-			abstract1 meet_guards = (iter->guards);
-			environment env = AnalysisUtils::JoinEnvironments(meet_guards.get_environment(),guard_abs.get_environment());
-			meet_guards.change_environment(mgr,env);
-			guard_abs.change_environment(mgr,env);
-			meet_guards.meet(mgr,guard_abs);
-			if (!(iter->vars.abstract()->is_bottom(mgr) || meet_guards.is_bottom(mgr)))
-				met_abs_set.insert(Abstract2(iter->vars,(meet_guards)));
+			const abstract1 * guards_ptr = iter->guards.abstract();
+			if (!met_guards.count(guards_ptr)) {
+				// guards with no common 0/1 valuation are dropped without meeting the abstracts. this may drop
+				// guards whose apron meet is not bottom (e.g. g+h=1 and g=h, at g=h=1/2), see Meet above
+				if (GuardBDD::And(GuardBDD::FromAbstract(iter->guards),guard_bdd) == GuardBDD::kFalse) {
+					met_guards[guards_ptr] = NULL;
+				} else {
+					abstract1 meet_guards = (iter->guards);
+					environment env = AnalysisUtils::JoinEnvironments(meet_guards.get_environment(),guard_abs.get_environment());
+					meet_guards.change_environment(mgr,env);
+					guard_abs.change_environment(mgr,env);
+					meet_guards.meet(mgr,guard_abs);
+					met_guards[guards_ptr] = meet_guards.is_bottom(mgr) ? NULL : Abstract1(meet_guards).abstract();
+				}
+			}
+			if (met_guards[guards_ptr] && !iter->vars.abstract()->is_bottom(mgr))
+				met_abs_set.insert(Abstract2(iter->vars,Abstract1(met_guards[guards_ptr])));
 		}
 	}
 	abs_set_ = met_abs_set;
@@ -695,22 +910,19 @@ void APAbstractDomain_ValueTypes::ValTy::WidenByGuards(const ValTy& pre, const V
 #if (DEBUGWidening)
 	cerr << "<-----\nWidening: " << pre << "\nAnd: "<< post << "\n";
 #endif
-	map<Abstract1, Abstract1> pre_partition = JoinByPartition(pre.PartitionByGuards());//PartitionByGuards2();
-	map<Abstract1, Abstract1> post_partition = JoinByPartition(post.PartitionByGuards());//post.PartitionByGuards2();
+	map<const abstract1*,Abstract2> pre_partition = JoinByPartition(pre.PartitionByGuards());
+	map<const abstract1*,Abstract2> post_partition = JoinByPartition(post.PartitionByGuards());
 
 
 	result.abs_set_.clear();
 	manager mgr = *mgr_ptr_;
-	for (map<Abstract1, Abstract1>::const_iterator iter = pre_partition.begin(), end = pre_partition.end(); iter != end; ++iter ) {
-		Abstract1 guards = iter->first;
-#if (DEBUGWidening)
-		//cerr << "Trying to match: " << guards << "...\n";
-#endif
-		abstract1 widened_abs = iter->second;
-		// try and find an abstract of the same equivalence class
+	for (map<const abstract1*,Abstract2>::const_iterator iter = pre_partition.begin(), end = pre_partition.end(); iter != end; ++iter ) {
+		const abstract1 * guards = iter->first;
+		abstract1 widened_abs = iter->second.vars;
+		// try and find an abstract with the same guards
 		if (post_partition.count(guards)) {
 			// if found, widen it with the matching abstract from rhs
-			abstract1 post_abs = post_partition[guards];
+			abstract1 post_abs = post_partition[guards].vars;
 			environment env = AnalysisUtils::JoinEnvironments(widened_abs.get_environment(),post_abs.get_environment());
 			widened_abs.change_environment(mgr,env);
 			post_abs.change_environment(mgr,env);
@@ -724,12 +936,11 @@ void APAbstractDomain_ValueTypes::ValTy::WidenByGuards(const ValTy& pre, const V
 #endif
 			post_partition.erase(guards);
 		} // otherwise simply add it to the result
-		result.abs_set_.insert(Abstract2(Abstract1(widened_abs),guards));
+		result.abs_set_.insert(Abstract2(Abstract1(widened_abs),iter->second.guards));
 	}
 	// take care of the unmateched abstracts that remain in post
-	for (map<Abstract1,Abstract1>::const_iterator iter = post_partition.begin(), end = post_partition.end(); iter != end; ++iter )
-		// remember that the partition is guards->abs so iter->first should be second in the pair and vice versa
-		result.abs_set_.insert(Abstract2(iter->second,iter->first));
+	for (map<const abstract1*,Abstract2>::const_iterator iter = post_partition.begin(), end = post_partition.end(); iter != end; ++iter )
+		result.abs_set_.insert(iter->second);
 
 #if (DEBUGWidening)
 	cerr << "Result: " << result << "\n----->\n";
@@ -968,14 +1179,16 @@ string APAbstractDomain_ValueTypes::ValTy::ComputeDiff(bool report_on_diff, bool
 	// before negation we took out all the (V==V') constraints as they will repeat in every negation
 	// i.e. we are replacing the computation: ~tau1 /\ ... /\ ~tauN = (p1 \/ V!=V') /\ ... /\ (pN \/ V!=V')
 	// with : (p1 /\ ... /\ pn) \/ (V!=V')	therefore we now need to add ( V!=V' ) to phi
+	// (phi may be empty if the cross-conjunction was false, then it is made of the (V!=V') part alone)
+	environment phi_env = phi.size() ? phi.begin()->get_environment() :
+			(guards ? AnalysisUtils::JoinEnvironments(env,guards_env) : env);
 	vector<var> vars = env.get_vars();
 	for (size_t i = 0 ; i < vars.size(); ++i ) {
 		string v = vars[i], v_tag;
 		Utils::Names(v,v_tag);
 		pair<tcons1,tcons1> diff_cons = AnalysisUtils::GetDiffCons(env,v,v_tag);
-		assert(phi.size());
-		phi.insert(AnalysisUtils::AbsFromConstraint(mgr,diff_cons.first).change_environment(mgr,phi.begin()->get_environment()));
-		phi.insert(AnalysisUtils::AbsFromConstraint(mgr,diff_cons.second).change_environment(mgr,phi.begin()->get_environment()));
+		phi.insert(AnalysisUtils::AbsFromConstraint(mgr,diff_cons.first).change_environment(mgr,phi_env));
+		phi.insert(AnalysisUtils::AbsFromConstraint(mgr,diff_cons.second).change_environment(mgr,phi_env));
 	}
 	if (guards) {
 		vars = guards_env.get_vars();
@@ -983,9 +1196,8 @@ string APAbstractDomain_ValueTypes::ValTy::ComputeDiff(bool report_on_diff, bool
 			string v = vars[i], v_tag;
 			Utils::Names(v,v_tag);
 			pair<tcons1,tcons1> diff_cons = AnalysisUtils::GetDiffCons(env,v,v_tag);
-			assert(phi.size());
-			phi.insert(AnalysisUtils::AbsFromConstraint(mgr,diff_cons.first).change_environment(mgr,phi.begin()->get_environment()));
-			phi.insert(AnalysisUtils::AbsFromConstraint(mgr,diff_cons.second).change_environment(mgr,phi.begin()->get_environment()));
+			phi.insert(AnalysisUtils::AbsFromConstraint(mgr,diff_cons.first).change_environment(mgr,phi_env));
+			phi.insert(AnalysisUtils::AbsFromConstraint(mgr,diff_cons.second).change_environment(mgr,phi_env));
 		}
 	}
 
@@ -1037,7 +1249,7 @@ string APAbstractDomain_ValueTypes::ValTy::ComputeDiff(bool report_on_diff, bool
 		}
 	}
 
-	set<abstract1> minimized_result_plus = AnalysisUtils::MinimizeResult(mgr,result_plus);
+	set<abstract1> minimized_result_plus = AnalysisUtils::MinimizeResult(mgr,ManagerType(),result_plus);
 	for (set<abstract1>::iterator iter = minimized_result_plus.begin(), end = minimized_result_plus.end(); iter != end; ++iter) {
 		abstract1 diff_clean = *iter;
 		diff_clean = AnalysisUtils::ForgetGuards(diff_clean);
@@ -1056,7 +1268,7 @@ string APAbstractDomain_ValueTypes::ValTy::ComputeDiff(bool report_on_diff, bool
 		delta_plus.abs_set_.insert(Abstract2(Abstract1(diff_clean),Abstract1()));
 	}
 
-	set<abstract1> minimized_result_minus = AnalysisUtils::MinimizeResult(mgr,result_minus);
+	set<abstract1> minimized_result_minus = AnalysisUtils::MinimizeResult(mgr,ManagerType(),result_minus);
 	for (set<abstract1>::iterator iter = minimized_result_minus.begin(), end = minimized_result_minus.end(); iter != end; ++iter) {
 		abstract1 diff_clean = *iter;
 		diff_clean = AnalysisUtils::ForgetGuards(diff_clean);
@@ -1093,13 +1305,19 @@ void APChecker::ObserveFixedPoint(bool report_on_diff, bool compute_diff, unsign
 	report_on_diff = false; // Report all
 #endif
 
+	manager * mgr_ptr = ValTy::mgr_ptr_;
 	for ( map<SourceLocation,APAbstractDomain::ValTy>::iterator iter  = corr_points_states_.begin(), end = corr_points_states_.end(); iter != end; ++iter ) {
+		if (!Reported(iter->first))
+			continue;
 		unsigned index = 0;
 		APAbstractDomain::ValTy state = iter->second;
 		SourceLocation location = iter->first;
 		string report_string;
 		raw_string_ostream report_os(report_string);
 
+		// in cascade mode the state may come from a different manager than the current one
+		ValTy::mgr_ptr_ = settling_mgrs_.count(location) ? settling_mgrs_[location] : mgr_ptr;
+
 		// partition one last time if strategy was at-corr-point
 		if (state.partition_point_ == AnalysisConfiguration::PARTITION_AT_CORR_POINT)
 			state.Partition();
@@ -1113,8 +1331,15 @@ void APChecker::ObserveFixedPoint(bool report_on_diff, bool compute_diff, unsign
 		llvm::outs() << report_os.str();
 #endif
 
-		APAbstractDomain_ValueTypes::ValTy delta_plus,delta_minus;
-		string diff_string = state.ComputeDiff(report_on_diff,compute_diff,true,delta_plus,delta_minus);
+		string diff_string;
+		if (report_on_diff) {
+			diff_string = ComputeDiffAt(location,compute_diff);
+		} else {
+			APAbstractDomain_ValueTypes::ValTy delta_plus,delta_minus;
+			diff_string = state.ComputeDiff(report_on_diff,compute_diff,true,delta_plus,delta_minus);
+		}
+		if (settling_domains_.count(location))
+			report_os << "Settled by: " << settling_domains_[location] << "\n";
 		report_os << diff_string;
 
 		// Create the report according to flags
@@ -1131,6 +1356,8 @@ void APChecker::ObserveFixedPoint(bool report_on_diff, bool compute_diff, unsign
 		}
 	}
 
+	ValTy::mgr_ptr_ = mgr_ptr;
+
 	map<unsigned,FullSourceLoc>::const_iterator ordered_locations_iter = ordered_locations.begin(), ordered_locations_end = ordered_locations.end();
 	map<unsigned,unsigned>::const_iterator ordered_diag_ids_iter = ordered_diag_ids.begin();
 	if ( ordered_locations_iter != ordered_locations_end ) {
@@ -1155,9 +1382,63 @@ void APChecker::ObserveFixedPoint(bool report_on_diff, bool compute_diff, unsign
 
 }
 
+bool APChecker::Reported(SourceLocation location) const {
+	return report_lines_.empty() || report_lines_.count(contex_.getFullLoc(location).getExpansionLineNumber());
+}
+
+string APChecker::ComputeDiffAt(SourceLocation location, bool compute_diff) {
+	map<SourceLocation,string>::const_iterator iter = diff_strings_.find(location);
+	if (iter != diff_strings_.end())
+		return iter->second;
+	if (!corr_points_states_.count(location))
+		return "";
+	ValTy state = corr_points_states_[location];
+	if (state.partition_point_ == AnalysisConfiguration::PARTITION_AT_CORR_POINT)
+		state.Partition();
+	ValTy delta_plus,delta_minus;
+	return (diff_strings_[location] = state.ComputeDiff(true,compute_diff,true,delta_plus,delta_minus));
+}
+
+/**
+ * Compute the diff of every reported point with the current manager, and record that manager as the one
+ * that settled them. The diffs are kept so ObserveFixedPoint does not recompute them.
+ */
+bool APChecker::Settle(bool compute_diff) {
+	bool all_equivalent = true;
+	for ( map<SourceLocation,ValTy>::iterator iter  = corr_points_states_.begin(), end = corr_points_states_.end(); iter != end; ++iter ) {
+		if (!Reported(iter->first))
+			continue;
+		settling_mgrs_[iter->first] = ValTy::mgr_ptr_;
+		settling_domains_[iter->first] = AnalysisConfiguration::manager_type_;
+		if (!ComputeDiffAt(iter->first,compute_diff).empty())
+			all_equivalent = false;
+	}
+	return all_equivalent;
+}
+
+/**
+ * The points the cheap manager could not prove equivalent take the state (and diff) computed by
+ * the precise run, which must be the current manager. Points that were proven keep the cheap result.
+ */
+void APChecker::Escalate(APChecker &precise, bool compute_diff) {
+	for ( map<SourceLocation,ValTy>::iterator iter  = corr_points_states_.begin(), end = corr_points_states_.end(); iter != end; ++iter ) {
+		SourceLocation location = iter->first;
+		if (!Reported(location) || diff_strings_[location].empty() || !precise.corr_points_states_.count(location))
+			continue;
+		iter->second = precise.corr_points_states_[location];
+		diff_strings_[location] = precise.ComputeDiffAt(location,compute_diff);
+		settling_mgrs_[location] = ValTy::mgr_ptr_;
+		settling_domains_[location] = AnalysisConfiguration::cascade_manager_type_;
+	}
+}
+
 void APAbstractDomain::InitializeValues(const CFG& cfg) {
 	RegisterDecls R(getAnalysisData());
 	cfg.VisitBlockStmts(R);
+	if (VariablePacks::enabled_) {
+		VariablePacks::Clear();
+		VariablePacks::AddCFG(cfg);
+	}
 }
 
 ostream& operator<<(ostream& os, const APAbstractDomain_ValueTypes::ValTy & V) {
@@ -17,6 +17,7 @@ using namespace std;
 #include "AnalysisConfiguration.h"
 #include "Abstract1.h"
 #include "AnalysisUtils.h"
+#include "GuardBDD.h"
 
 #include "apronxx/apronxx.hh"
 using namespace apron;
@@ -72,10 +73,16 @@ public:
 
 		AbstractSet abs_set_;
 		static manager *mgr_ptr_;
+		static manager *cascade_mgr_ptr_; // more precise manager to escalate to (NULL if not cascading)
+		static const string & ManagerType(); // the type of the manager mgr_ptr_ currently points to
+		static const string & ManagerType(const manager &mgr); // the type of the given manager (-m or -m_c)
 		environment env_; // shared environment for all abstracts in AbsSet
 
 		static map< var, vector<var> > read_map_;   // l: v = A[i] is kept here as read(A,idx_l) -> (v,A,idx_l)
 		static map< var, vector<var> > update_map_; // l: A[i] = e is kept here as update(A,idx_l) -> (A,idx_l)
+		static void AddArrayRead(const var& read, const var& array, const var& index);
+		static void AddArrayUpdate(const var& update, const var& array, const var& index);
+		static void ClearArrayAccesses();
 
 		bool at_diff_point_;
 
@@ -96,10 +103,16 @@ public:
 		void print(raw_ostream &os) const { os << *this << '\n'; }
 		bool isTop() const;
 		void Assign(const environment& expr_env, const var& variable, texpr1 expr, bool is_guard = false);
+		typedef vector< pair<var,texpr1> > Assignments;
+		// simultaneous assignment: all expressions are evaluated in the current state (one apron call per abstract)
+		void Assign(const Assignments& assignments, const Assignments& guard_assignments);
 		void Forget(string name); // forget given var from the state.
+		void Project(const vector<var> &vars); // remove the given vars from the state (dimensions are dropped, not just unconstrained).
 		void Assume(const set<abstract1>& added_abs_set); // Assume set{abs1,abs2} means assume (abs1 v abs2)
 
 		friend ostream& operator<<(ostream& os, const ValTy& V);
+		uint64_t Fingerprint() const; // hash of the interned abstracts in the set
+		bool SameAbstracts(const ValTy& rhs) const; // the sets hold the very same interned abstracts
 		bool operator==(const ValTy& rhs) const;
 		bool operator!=(const ValTy& rhs) const { return !(*this == rhs); }
 		bool operator<=(const ValTy& rhs) const;
@@ -120,7 +133,7 @@ public:
 		void JoinAll(); // joins all abstracts in the set into one abstract i.e. it performs: |_|{abs_1,...,abs_n}
 
 		bool Partition();
-		map<Abstract1,AbstractSet> PartitionByGuards() const; // returns a mapping: {guards} ->  [abstracts]
+		map<const abstract1*,AbstractSet> PartitionByGuards() const; // returns a mapping: {guards} ->  [abstracts]
 		map<set<var>,AbstractSet> PartitionByEquivalence() const;
 
 		bool CanBeReduced(string arr_name, string arr2_name);
@@ -129,10 +142,23 @@ public:
 		void ApplyArrayUpdateDeductionRule(void);
 
 	private:
+		// the reads/updates of each (untagged) array, per version, in the order they were added
+		struct ArrayAccesses { vector<var> accesses[2]; };
+		static map<string,ArrayAccesses> read_index_, update_index_;
+		static map<var,unsigned> access_seq_; // the order in which each read/update was added
+		// abstract -> (number of accesses when the rule was applied to it, result)
+		typedef map<const abstract1*,pair<unsigned,Abstract1> > DeductionCache;
+		static DeductionCache read_deduced_, update_deduced_;
+		static void AddArrayAccess(map< var,vector<var> > &accesses, map<string,ArrayAccesses> &index, const var& access, const var& array, const var& idx);
+		static bool IsNewPair(const var& access, const var& access2, unsigned seq);
+		static Abstract1 ApplyArrayReadDeductionRule(const Abstract1 &vars, unsigned seq);
+		static Abstract1 ApplyArrayUpdateDeductionRule(const Abstract1 &vars, unsigned seq);
+		static Abstract1 ApplyDeductionRule(DeductionCache &cache, const Abstract1 &vars, Abstract1 (*rule)(const Abstract1&,unsigned));
+
 		static map<set<var>,Abstract2> JoinByPartition(map<set<var>,AbstractSet> partition);
-		static map<Abstract1,Abstract1> JoinByPartition(map<Abstract1,AbstractSet> partition);
+		static map<const abstract1*,Abstract2> JoinByPartition(map<const abstract1*,AbstractSet> partition);
 		static AbstractSet PartitionToAbsSet(map<set<var>,Abstract2> partition);
-		static AbstractSet PartitionToAbsSet(map<Abstract1,Abstract1> partition);
+		static AbstractSet PartitionToAbsSet(map<const abstract1*,Abstract2> partition);
 
 	public:
 
@@ -192,8 +218,15 @@ class APChecker	: public APAbstractDomain::ObserverTy
 	DiagnosticsEngine           &diagnostics_engine_;
 	Preprocessor                *preprocessor_ptr_;
 	map<SourceLocation,ValTy>   corr_points_states_;
+	map<SourceLocation,string>  diff_strings_;    // diffs computed so far (by a query, or ahead of the report in cascade mode)
+	map<SourceLocation,manager*> settling_mgrs_;  // the manager whose result is kept for each point
+	map<SourceLocation,string>  settling_domains_;
+
+	bool Reported(SourceLocation location) const;
 
 public:
+	static set<unsigned> report_lines_; // lines of the points to compute and report deltas at (empty for all)
+
 	APChecker(ASTContext &contex, DiagnosticsEngine &diagnostics_engine, Preprocessor * preprocessor_ptr) :
 		rewriter_(contex.getSourceManager(),contex.getLangOptions()), contex_(contex),
 		diagnostics_engine_(diagnostics_engine), preprocessor_ptr_(preprocessor_ptr) { }
@@ -206,6 +239,14 @@ public:
 
 	/// Print fixed-point range information when the analysis is done
 	void ObserveFixedPoint(bool report_on_diff, bool compute_diff, unsigned &report_ctr);
+
+	/// After the fixed-point: the delta at the given correlation point, computed on the first query
+	string ComputeDiffAt(SourceLocation location, bool compute_diff);
+
+	/// Cascade mode: true if every point was proven equivalent with the current manager
+	bool Settle(bool compute_diff);
+	/// Cascade mode: take the unsettled points from a run with a more precise manager
+	void Escalate(APChecker &precise, bool compute_diff);
 };
 
 } // end namespace differential
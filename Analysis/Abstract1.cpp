@@ -3,6 +3,8 @@
 #include "../Utils.h"
 #include "../Defines.h"
 #include "AnalysisUtils.h"
+#include "VariablePacks.h"
+#include "APAbstractDomain.h"
 
 #include <set>
 #include <sstream>
@@ -19,9 +21,12 @@ map<const abstract1*,string > Abstract1::abstract_to_string;
 Abstract1 Abstract1::AddAbstractToAll(const abstract1 &abstract) {
 	/**
 	 * look for an abstract that looks like the input in the dictionary by creating an Abstract1 from it
-	 * and using it to search the map (Abstract1's < and > operators actually use the inner abstract for comparing
+	 * and using it to search the map (Abstract1's < and > operators actually use the inner abstract for comparing.
+	 * the key is qualified by the manager type, as in cascade mode equal looking abstracts may belong to different managers
+	 * (the library name is not enough: polka and polka_strict share one)
 	 */
-	string key = Abstract1(&abstract).key();
+	manager mgr = abstract.get_manager();
+	string key = APAbstractDomain_ValueTypes::ValTy::ManagerType(mgr) + ":" + Abstract1(&abstract).key();
 
 	if (abstract_dictionary.find(key) == abstract_dictionary.end()) {
 		abstract_dictionary[key] = new abstract1(abstract);
@@ -124,13 +129,37 @@ const set<var>& Abstract1::NonEquivVars() const {
 			result.insert(vars[i]);
 		}
 	} else {
+		// first settle whatever follows from plain (x == y) equalities, no meets needed for those
 		const set<var>& common_vars = CommonVars();
+		map<var,size_t> classes = AnalysisUtils::EqualityClasses(*abstract_ptr_);
+		set<var> unsettled;
 		for (set<var>::const_iterator iter = common_vars.begin(), end = common_vars.end(); iter != end; ++iter) {
 			string name = *iter,name_tag;
 			Utils::Names(name,name_tag);
-			// when all else fails, do the heavy domain check:
-			if (!AnalysisUtils::IsEquivalent(*abstract_ptr_,name,name_tag))
-				result.insert(name);
+			if (classes[name] != classes[name_tag])
+				unsettled.insert(*iter);
+		}
+
+		if (unsettled.empty()) {
+			// nothing left to check
+		} else if (VariablePacks::enabled_) {
+			// check pack by pack, each on its own part of the abstract (v and v' always share a part)
+			map<var,size_t> part_of;
+			vector<abstract1> parts = VariablePacks::Split(*abstract_ptr_,unsettled,part_of);
+			for (set<var>::const_iterator iter = unsettled.begin(), end = unsettled.end(); iter != end; ++iter) {
+				string name = *iter,name_tag;
+				Utils::Names(name,name_tag);
+				if (!AnalysisUtils::IsEquivalent(parts[part_of[name]],name,name_tag))
+					result.insert(name);
+			}
+		} else {
+			for (set<var>::const_iterator iter = unsettled.begin(), end = unsettled.end(); iter != end; ++iter) {
+				string name = *iter,name_tag;
+				Utils::Names(name,name_tag);
+				// when all else fails, do the heavy domain check:
+				if (!AnalysisUtils::IsEquivalent(*abstract_ptr_,name,name_tag))
+					result.insert(name);
+			}
 		}
 	}
 	abstract_to_nonequiv_vars[abstract_ptr_] = result;
@@ -6,6 +6,10 @@
  */
 
 #include "AnalysisConfiguration.h"
+#include "DBMDomain.h"
+
+#include <algorithm>
+#include <sstream>
 
 #include "apronxx/apxx_box.hh"
 #include "apronxx/apxx_oct.hh"
@@ -28,47 +32,91 @@ const char * AnalysisConfiguration::kManagerTypePPLGrids =          "ppl_grids";
 const char * AnalysisConfiguration::kManagerTypePolkaPPL =          "polka_ppl";
 const char * AnalysisConfiguration::kManagerTypePolkaPPLStrict =    "polka_ppl_strict";
 const char * AnalysisConfiguration::kManagerTypeTaylor1Plus =    	"t1p";
-const char * AnalysisConfiguration::kManagerTypes =                 "box|oct|polka|polka_strict|ppl(default)|ppl_strict|ppl_grids|polka_ppl|polka_ppl_strict";
+const char * AnalysisConfiguration::kManagerTypeDBM =               "dbm";
+const char * AnalysisConfiguration::kManagerTypes =                 "box|oct|dbm|polka|polka_strict|ppl(default)|ppl_strict|ppl_grids|polka_ppl|polka_ppl_strict";
+
+std::string AnalysisConfiguration::manager_type_ = AnalysisConfiguration::kManagerTypePPL;
+
+// the printed name of the manager type, unknown types are normalized to the default (ppl)
+std::string AnalysisConfiguration::NormalizeManagerType(std::string &manager_type) {
+	if (manager_type == kManagerTypeBox) {
+		return "Box";
+	} else if (manager_type == kManagerTypeOctagon) {
+		return "Octagon";
+	} else if (manager_type == kManagerTypeDBM) {
+		return "DBM (native difference bounds)";
+	} else if (manager_type == kManagerTypePolka) {
+		return "Polka (loose)";
+	} else if (manager_type == kManagerTypePolkaStrict) {
+		return "Polka (strict)";
+	} else if (manager_type == kManagerTypePPLStrict) {
+		return "PPL (polyhedra, strict)";
+	} else if (manager_type == kManagerTypePPLGrids) {
+		return "PPL (grids)";
+	} else if (manager_type == kManagerTypePolkaPPL) {
+		return "Product Polka (loose) * PPL grids";
+	} else if (manager_type == kManagerTypePolkaPPLStrict) {
+		return "Product Polka (strict) * PPL grids";
+	} else {
+		manager_type = kManagerTypePPL;
+		return "PPL (polyhedra, loose)";
+	}
+}
 
 manager * AnalysisConfiguration::ParseManager(ClList manager_type) {
-	outs() << "Domain: ";
-	if (manager_type.size()) {
-		if (manager_type[0] == kManagerTypeBox) {
-			outs() << "Box\n";
-			return new box_manager();
-		} else if (manager_type[0] == kManagerTypeOctagon) {
-			outs() << "Octagon\n";
-			return new oct_manager();
-		} else if (manager_type[0] == kManagerTypePolka) {
-			outs() << "Polka (loose)\n";
-			return new polka_manager();
-		} else if (manager_type[0] == kManagerTypePolkaStrict) {
-			outs() << "Polka (strict)\n";
-			return new polka_manager(true);
-		} else if (manager_type[0] == kManagerTypePPL) {
-			outs() << "PPL (polyhedra, loose)\n";
-			return new ppl_poly_manager();
-		} else if (manager_type[0] == kManagerTypePPLStrict) {
-			outs() << "PPL (polyhedra, strict)\n";
-			return new ppl_poly_manager(true);
-		} else if (manager_type[0] == kManagerTypePPLGrids) {
-			outs() << "PPL (grids)\n";
-			return new ppl_grid_manager();
-		} else if (manager_type[0] == kManagerTypePolkaPPL) {
-			outs() << "Product Polka (loose) * PPL grids\n";
-			return new pkgrid_manager(false);
-		} else if (manager_type[0] == kManagerTypePolkaPPLStrict) {
-			outs() << "Product Polka (strict) * PPL grids\n";
-			return new pkgrid_manager(true);
-//		} else if (manager_type[0] == kManagerTypeTaylor1Plus) {
-//			outs() << "Taylor1plus\n";
-//			return new t1p_manager();
-		} else {
-			outs() << "PPL (polyhedra, loose)\n";
-			return new ppl_poly_manager();
-		}
+	manager_type_ = (manager_type.size()) ? manager_type[0] : kManagerTypePPL;
+	outs() << "Domain: " << NormalizeManagerType(manager_type_) << "\n";
+	return CreateManager(manager_type_);
+}
+
+/**
+ * Cascade mode: functions are analyzed with the manager picked by ParseManager first, and only
+ * re-analyzed with this one if some correlation point could not be proven equivalent.
+ * Unknown types fall back to ppl, like in ParseManager. Returns NULL when no cascade manager was
+ * requested, or when it is the first manager again.
+ */
+std::string AnalysisConfiguration::cascade_manager_type_ = "";
+
+manager * AnalysisConfiguration::ParseCascadeManager(ClList manager_type) {
+	outs() << "Cascade Domain: ";
+	std::string cascade_type = (manager_type.size()) ? manager_type[0] : "";
+	std::string description = cascade_type.size() ? NormalizeManagerType(cascade_type) : "";
+	if (!cascade_type.size() || cascade_type == manager_type_) {
+		cascade_manager_type_ = "";
+		outs() << "none\n";
+		return NULL;
+	}
+	cascade_manager_type_ = cascade_type;
+	outs() << description << "\n";
+	return CreateManager(cascade_manager_type_);
+}
+
+/**
+ * Create a new manager of the given type. Managers are not thread safe, so this is also
+ * used to give each worker thread a manager of its own (of the same type as the main one).
+ */
+manager * AnalysisConfiguration::CreateManager(const std::string &manager_type) {
+	if (manager_type == kManagerTypeBox) {
+		return new box_manager();
+	} else if (manager_type == kManagerTypeOctagon) {
+		return new oct_manager();
+	} else if (manager_type == kManagerTypeDBM) {
+		return new DBMManager();
+	} else if (manager_type == kManagerTypePolka) {
+		return new polka_manager();
+	} else if (manager_type == kManagerTypePolkaStrict) {
+		return new polka_manager(true);
+	} else if (manager_type == kManagerTypePPLStrict) {
+		return new ppl_poly_manager(true);
+	} else if (manager_type == kManagerTypePPLGrids) {
+		return new ppl_grid_manager();
+	} else if (manager_type == kManagerTypePolkaPPL) {
+		return new pkgrid_manager(false);
+	} else if (manager_type == kManagerTypePolkaPPLStrict) {
+		return new pkgrid_manager(true);
+//	} else if (manager_type == kManagerTypeTaylor1Plus) {
+//		return new t1p_manager();
 	} else {
-		outs() << "PPL (polyhedra, loose)\n";
 		return new ppl_poly_manager();
 	}
 }
@@ -205,6 +253,54 @@ unsigned AnalysisConfiguration::ParseWideningThreshold(ClList widening_threshold
 	return result;
 }
 
+// Variable Packing
+bool AnalysisConfiguration::ParseVariablePacking(ClList packing) {
+	bool result = (packing.size() && packing[0] == "true");
+	outs() << "Variable Packing: " << (result ? "on" : "off") << '\n';
+	return result;
+}
+
+// Arrays
+unsigned AnalysisConfiguration::ParseArrayIndexPool(ClList pool_size) {
+	unsigned result = 0;
+	if (pool_size.size())
+		result = atoi(pool_size[0].c_str());
+	outs() << "Array Index Pool: ";
+	if (result)
+		outs() << result << " per array\n";
+	else
+		outs() << "off\n";
+	return result;
+}
+
+// Liveness
+bool AnalysisConfiguration::ParseLivenessProjection(ClList liveness) {
+	bool result = (liveness.size() && liveness[0] == "true");
+	outs() << "Liveness Projection: " << (result ? "on" : "off") << '\n';
+	return result;
+}
+
+// Warm start: the directory fixpoints are loaded from and stored to (empty for none)
+std::string AnalysisConfiguration::ParseWarmStart(ClList directory) {
+	std::string result = directory.size() ? directory[0] : "";
+	outs() << "Warm Start: " << (result.size() ? result : "off") << '\n';
+	return result;
+}
+
+// Change impact
+bool AnalysisConfiguration::ParseChangeImpact(ClList impact) {
+	bool result = (impact.size() && impact[0] == "true");
+	outs() << "Change Impact Filter: " << (result ? "on" : "off") << '\n';
+	return result;
+}
+
+// Call summaries
+bool AnalysisConfiguration::ParseCallSummaries(ClList summaries) {
+	bool result = (summaries.size() && summaries[0] == "true");
+	outs() << "Call Summaries: " << (result ? "on" : "off") << '\n';
+	return result;
+}
+
 // Speculative
 const int AnalysisConfiguration::kInterleavignLookaheadWindow = 2;
 int AnalysisConfiguration::ParseInterleavignLookaheadWindow(ClList window) {
@@ -228,5 +324,100 @@ int AnalysisConfiguration::ParseInterleavignLookaheadPartition(ClList partition)
 	return result;
 }
 
+bool AnalysisConfiguration::ParseAdaptiveLookahead(ClList adaptive) {
+	bool result = (adaptive.size() && adaptive[0] == "true");
+	outs() << "Adaptive lookahead window: " << (result ? "on" : "off") << '\n';
+	return result;
+}
+
+// how far the adaptive window may grow (default and upper bound: limit)
+int AnalysisConfiguration::ParseLookaheadCap(ClList cap, int limit) {
+	int result = limit;
+	if (cap.size() && atoi(cap[0].c_str()) > 0)
+		result = std::min(atoi(cap[0].c_str()),limit);
+	outs() << "Adaptive lookahead cap: " << result << '\n';
+	return result;
+}
+
+bool AnalysisConfiguration::ParseLockstep(ClList lockstep) {
+	bool result = (lockstep.size() && lockstep[0] == "true");
+	outs() << "Lockstep over common blocks: " << (result ? "on" : "off") << '\n';
+	return result;
+}
+
+// comma separated function names, printf if none are given
+std::set<std::string> AnalysisConfiguration::ParseObservableCallees(ClList callees) {
+	std::set<std::string> result;
+	for (unsigned i = 0; i < callees.size(); ++i) {
+		std::stringstream ss(callees[i]);
+		std::string name;
+		while (std::getline(ss,name,','))
+			if (name.size())
+				result.insert(name);
+	}
+	if (result.empty())
+		result.insert("printf");
+	outs() << "Observable Callees: ";
+	for (std::set<std::string>::const_iterator iter = result.begin(), end = result.end(); iter != end; ++iter)
+		outs() << (iter == result.begin() ? "" : ",") << *iter;
+	outs() << '\n';
+	return result;
+}
+
+// comma separated line numbers of correlation points, all points if none are given
+std::set<unsigned> AnalysisConfiguration::ParseReportLines(ClList lines) {
+	std::set<unsigned> result;
+	for (unsigned i = 0; i < lines.size(); ++i) {
+		std::stringstream ss(lines[i]);
+		std::string line;
+		while (std::getline(ss,line,','))
+			if (atoi(line.c_str()) > 0)
+				result.insert(atoi(line.c_str()));
+	}
+	outs() << "Reported Lines: ";
+	if (result.empty())
+		outs() << "all";
+	for (std::set<unsigned>::const_iterator iter = result.begin(), end = result.end(); iter != end; ++iter)
+		outs() << (iter == result.begin() ? "" : ",") << *iter;
+	outs() << '\n';
+	return result;
+}
+
+// comma separated block ID pairs (first:second, exit for the exit blocks), the exit and the observable pairs if none are given
+std::set< std::pair<unsigned,unsigned> > AnalysisConfiguration::ParseReportPairs(ClList pairs) {
+	std::set< std::pair<unsigned,unsigned> > result;
+	for (unsigned i = 0; i < pairs.size(); ++i) {
+		std::stringstream ss(pairs[i]);
+		std::string pair;
+		while (std::getline(ss,pair,',')) {
+			size_t colon = pair.find(':');
+			if (pair == "exit")
+				result.insert(std::make_pair(0u,0u)); // the CFG builder creates the exit block first
+			else if (colon != std::string::npos)
+				result.insert(std::make_pair((unsigned)atoi(pair.substr(0,colon).c_str()),(unsigned)atoi(pair.substr(colon + 1).c_str())));
+		}
+	}
+	outs() << "Reported Block Pairs: ";
+	if (result.empty())
+		outs() << "exit and observable";
+	for (std::set< std::pair<unsigned,unsigned> >::const_iterator iter = result.begin(), end = result.end(); iter != end; ++iter)
+		outs() << (iter == result.begin() ? "" : ",") << iter->first << ':' << iter->second;
+	outs() << '\n';
+	return result;
+}
+
+// seconds per function, 0 means no budget
+double AnalysisConfiguration::ParseLookaheadTimeBudget(ClList budget) {
+	double result = 0;
+	if (budget.size())
+		result = atof(budget[0].c_str());
+	outs() << "Lookahead time budget: ";
+	if (result > 0)
+		outs() << result << " seconds per function\n";
+	else
+		outs() << "none\n";
+	return result;
+}
+
 }
 
@@ -1,6 +1,7 @@
 #ifndef ANALYSIS_CONF_H_
 #define ANALYSIS_CONF_H_
 
+#include <set>
 #include <string>
 
 #include <llvm/Support/CommandLine.h>
@@ -30,8 +31,14 @@ public:
 	static const char * kManagerTypePolkaPPL;
 	static const char * kManagerTypePolkaPPLStrict;
 	static const char * kManagerTypeTaylor1Plus;
+	static const char * kManagerTypeDBM;
 	static const char * kManagerTypes;
+	static std::string manager_type_; // the type of manager picked by ParseManager
+	static std::string NormalizeManagerType(std::string &manager_type); // returns the printed name
 	static apron::manager * ParseManager(ClList manager_type);
+	static apron::manager * CreateManager(const std::string &manager_type);
+	static std::string cascade_manager_type_; // empty if not cascading
+	static apron::manager * ParseCascadeManager(ClList manager_type);
 
 	// Partition Points
 	typedef enum { PARTITION_AT_NONE, PARTITION_AT_JOIN, PARTITION_AT_CORR_POINT } PartitionPoint;
@@ -68,11 +75,38 @@ public:
 	static const int kWideningThreshold;
 	static unsigned ParseWideningThreshold(ClList widening_threshold);
 
+	// Variable Packing
+	static bool ParseVariablePacking(ClList packing);
+
+	// Arrays
+	static unsigned ParseArrayIndexPool(ClList pool_size);
+
+	// Liveness
+	static bool ParseLivenessProjection(ClList liveness);
+
+	// Warm start
+	static std::string ParseWarmStart(ClList directory);
+
+	// Change impact
+	static bool ParseChangeImpact(ClList impact);
+
+	// Call summaries
+	static bool ParseCallSummaries(ClList summaries);
+
 	// Speculative
 	static const int kInterleavignLookaheadWindow;
 	static int ParseInterleavignLookaheadWindow(ClList window);
 	static const int kInterleavignLookaheadPartition;
 	static int ParseInterleavignLookaheadPartition(ClList partition);
+	static bool ParseAdaptiveLookahead(ClList adaptive);
+	static int ParseLookaheadCap(ClList cap, int limit);
+	static double ParseLookaheadTimeBudget(ClList budget);
+	static bool ParseLockstep(ClList lockstep);
+
+	// Reporting
+	static std::set<std::string> ParseObservableCallees(ClList callees);
+	static std::set<unsigned> ParseReportLines(ClList lines);
+	static std::set< std::pair<unsigned,unsigned> > ParseReportPairs(ClList pairs);
 };
 
 } // end namespace differential
@@ -18,6 +18,7 @@ using namespace std;
 using namespace clang;
 
 #include "AnalysisConsumer.h"
+#include "FixpointStore.h"
 
 namespace differential {
 
@@ -33,16 +34,65 @@ struct LowerOrEqual {
 
 typedef DataflowSolver<APAbstractDomain,TransferFuncs,Merge,LowerOrEqual> Solver;
 
-void AnalysisConsumer::AnalyzeFunction(CFG& cfg, ASTContext &contex, unsigned &report_ctr) {
-        // Compute the ranges information.
-    	cfg.print(llvm::outs(),LangOptions());
+// warm start: the solver keeps an edge value as long as what flows on the edge is lower or equal,
+// so seeding the edges with the fixpoint of an identical CFG lets it stop after one pass
+static void SeedEdges(CFG& cfg, APAbstractDomain &Dom, const map<FixpointStore::IDPair,State> &edges) {
+        map<unsigned,const CFGBlock*> blocks;
+        for (CFG::const_iterator iter = cfg.begin(), end = cfg.end(); iter != end; ++iter)
+            blocks[(*iter)->getBlockID()] = *iter;
+        for (map<FixpointStore::IDPair,State>::const_iterator iter = edges.begin(), end = edges.end(); iter != end; ++iter) {
+            if (blocks.count(iter->first.first) && blocks.count(iter->first.second))
+                Dom.getEdgeDataMap()[BlockEdge(blocks[iter->first.first],blocks[iter->first.second],0)] = iter->second;
+        }
+    }
+
+static void CollectEdges(APAbstractDomain &Dom, map<FixpointStore::IDPair,State> &edges) {
+        APAbstractDomain::EdgeDataMapTy &M = Dom.getEdgeDataMap();
+        for (APAbstractDomain::EdgeDataMapTy::iterator iter = M.begin(), end = M.end(); iter != end; ++iter) {
+            const BlockEdge &edge = cast<BlockEdge>(iter->first);
+            edges[make_pair(edge.getSrc()->getBlockID(),edge.getDst()->getBlockID())] = iter->second;
+        }
+    }
+
+void AnalysisConsumer::RunSolver(CFG& cfg, ASTContext &contex, APChecker &observer) {
         APAbstractDomain Dom(cfg);
         Dom.InitializeValues(cfg);
-        APChecker Observer(contex,diagnostics_engine_, preprocessor_ptr_);
-        Dom.getAnalysisData().Observer = &Observer;
+        Dom.getAnalysisData().Observer = &observer;
         Dom.getAnalysisData().setContext(contex);
+        string key;
+        map<FixpointStore::IDPair,State> edges;
+        if (FixpointStore::Enabled()) {
+            key = FixpointStore::Key(cfg,NULL,"dizy");
+            if (FixpointStore::Load(key,edges)) {
+                cerr << "Warm start from fixpoint " << key << ".\n";
+                SeedEdges(cfg,Dom,edges);
+            }
+        }
         Solver S(Dom);
         S.runOnCFG(cfg, true);
+        if (FixpointStore::Enabled()) {
+            edges.clear();
+            CollectEdges(Dom,edges);
+            FixpointStore::Store(key,edges);
+        }
+    }
+
+void AnalysisConsumer::AnalyzeFunction(CFG& cfg, ASTContext &contex, unsigned &report_ctr) {
+        // Compute the ranges information.
+    	cfg.print(llvm::outs(),LangOptions());
+        GuardBDD::Clear(); // the guards (and their order) of the previous function are of no use here
+        TransferFuncs::ClearCaches();
+        APChecker Observer(contex,diagnostics_engine_, preprocessor_ptr_);
+        RunSolver(cfg, contex, Observer);
+        // cascade: only if the cheap manager left some point unproven, pay for the precise one
+        manager * mgr_ptr = State::mgr_ptr_;
+        if (State::cascade_mgr_ptr_ && !Observer.Settle(compute_diff_)) {
+        	State::mgr_ptr_ = State::cascade_mgr_ptr_;
+        	APChecker PreciseObserver(contex,diagnostics_engine_, preprocessor_ptr_);
+        	RunSolver(cfg, contex, PreciseObserver);
+        	Observer.Escalate(PreciseObserver, compute_diff_);
+        	State::mgr_ptr_ = mgr_ptr;
+        }
         Observer.ObserveFixedPoint(true, compute_diff_, report_ctr);
     }
 
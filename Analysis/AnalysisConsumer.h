@@ -39,6 +39,7 @@ public:
 
 	void HandleTranslationUnit(ASTContext &contex);
 	void AnalyzeFunction(CFG& cfg, ASTContext &contex, unsigned &report_ctr);
+	void RunSolver(CFG& cfg, ASTContext &contex, APChecker &observer);
 
 };
 
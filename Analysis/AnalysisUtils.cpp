@@ -1,8 +1,13 @@
 #include "AnalysisUtils.h"
+#include "AnalysisConfiguration.h"
+#include "DBMDomain.h"
 #include "../Defines.h"
 #include "../Utils.h"
 #include <vector>
 #include <sstream>
+#include <algorithm>
+#include <pthread.h>
+#include <unistd.h>
 
 
 #define DEBUGNegate 	  	0
@@ -12,6 +17,19 @@ namespace differential {
 
 const texpr1 AnalysisUtils::kOne = texpr1::builder(environment(),1);
 const texpr1 AnalysisUtils::kZero = texpr1::builder(environment(),0);
+const size_t AnalysisUtils::kMaxCrossConjunctionSize = 128;
+const size_t AnalysisUtils::kParallelMinimizeThreshold = 64;
+const size_t AnalysisUtils::kMaxMinimizeThreads = 8;
+
+// splitmix64 finalizer
+uint64_t AnalysisUtils::Mix(uint64_t x) {
+	x ^= x >> 30;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 27;
+	x *= 0x94d049bb133111ebULL;
+	x ^= x >> 31;
+	return x;
+}
 
 abstract1 AnalysisUtils::AbsFromConstraint(manager &mgr, const tcons1 &cons) {
 	tcons1_array cons_arr(1,&cons);
@@ -148,6 +166,9 @@ bool AnalysisUtils::IsEquivalent(const abstract1 &abs, const var& v, const var &
 	if (!env.contains(v) || !env.contains(v_tag)) // if v or v' is not in the environment, equivalence can't hold
 		return false;
 
+	if (DBMManager::IsDBMManager(mgr)) // the bounds on v - v' are right there in the matrix
+		return DBMManager::IsEquivalent(abs,v,v_tag,IsGuard(v) && IsGuard(v_tag));
+
 	// try a textual search first
 //	stringstream abs_ss,constraint_ss;
 //	abs_ss << abs;
@@ -177,6 +198,86 @@ bool AnalysisUtils::IsEquivalent(const abstract1 &abs, const var& v, const var &
 	return (meet_lower.is_bottom(mgr));
 }
 
+namespace {
+
+size_t FindClass(vector<size_t> &parent, size_t dim) {
+	while (parent[dim] != dim) {
+		parent[dim] = parent[parent[dim]];
+		dim = parent[dim];
+	}
+	return dim;
+}
+
+}
+
+/**
+ * Union-find over the plain equalities that appear in the constraints of the abstract: a*x - a*y = 0
+ * puts x and y in one class, and x = c (an exact constant) puts x in the class of the constant.
+ * Two variables in the same class are equal, which settles most v == v' queries for unchanged code
+ * without any meet. Equalities spread over more variables are not used, so different classes
+ * do not mean the variables may differ. Coefficients are compared as scalars, never rounded.
+ */
+map<var,size_t> AnalysisUtils::EqualityClasses(const abstract1 &abs) {
+	manager mgr = abs.get_manager();
+	environment env = abs.get_environment();
+	const size_t size = env.intdim() + env.realdim();
+	vector<size_t> parent(size);
+	for (size_t i = 0; i < size; ++i)
+		parent[i] = i;
+	map<double,size_t> constants; // exact constant value -> a dimension fixed to it
+
+	ap_lincons1_array_t constraints = ap_abstract1_to_lincons_array(mgr.get_ap_manager_t(),const_cast<ap_abstract1_t*>(abs.get_ap_abstract1_t()));
+	ap_lincons0_array_t &array = constraints.lincons0_array;
+	ap_scalar_t * negated = ap_scalar_alloc();
+	for (size_t i = 0; i < array.size; ++i) {
+		ap_lincons0_t &cons = array.p[i];
+		if (cons.constyp != AP_CONS_EQ || cons.linexpr0->cst.discr != AP_COEFF_SCALAR)
+			continue;
+		vector<ap_dim_t> dims;
+		vector<ap_scalar_t*> coeffs;
+		bool scalar = true;
+		size_t k;
+		ap_dim_t dim;
+		ap_coeff_t * coeff;
+		ap_linexpr0_ForeachLinterm(cons.linexpr0,k,dim,coeff) {
+			if (ap_coeff_zero(coeff))
+				continue;
+			if (coeff->discr != AP_COEFF_SCALAR) {
+				scalar = false;
+				break;
+			}
+			dims.push_back(dim);
+			coeffs.push_back(coeff->val.scalar);
+		}
+		if (!scalar)
+			continue;
+		ap_scalar_t * cst = cons.linexpr0->cst.val.scalar;
+		if (dims.size() == 2 && ap_scalar_sgn(cst) == 0) {
+			ap_scalar_neg(negated,coeffs[1]);
+			if (ap_scalar_equal(coeffs[0],negated))
+				parent[FindClass(parent,dims[0])] = FindClass(parent,dims[1]);
+		} else if (dims.size() == 1 && (ap_scalar_equal_int(coeffs[0],1) || ap_scalar_equal_int(coeffs[0],-1))) {
+			// x + c = 0 or -x + c = 0, with c exactly representable
+			double value;
+			if (!ap_double_set_scalar(&value,cst,GMP_RNDN))
+				continue;
+			if (ap_scalar_equal_int(coeffs[0],1))
+				value = -value;
+			if (constants.count(value))
+				parent[FindClass(parent,dims[0])] = FindClass(parent,constants[value]);
+			else
+				constants[value] = dims[0];
+		}
+	}
+	ap_scalar_free(negated);
+	ap_lincons1_array_clear(&constraints);
+
+	map<var,size_t> result;
+	for (size_t i = 0; i < size; ++i)
+		result[env.get_var(i)] = FindClass(parent,i);
+	return result;
+}
+
 tcons1 AnalysisUtils::GetEquivCons(environment &env, var v, var v_tag, VarType type) {
 	if ( !env.contains(v) )
 		env = (type == Int ? env.add(&v,1,0,0) : env.add(0,0,&v,1));
@@ -436,8 +537,31 @@ set<abstract1> AnalysisUtils::NegateAbstract(manager &mgr, abstract1 &tau_i) {
 	return negated_tau_i;
 }
 
+/**
+ * Add the given conjunct to the disjunction, unless it is already subsumed by one of the disjuncts.
+ * Disjuncts that are subsumed by the new conjunct are removed, so the disjunction holds only maximal elements.
+ */
+void AnalysisUtils::InsertUnsubsumed(manager &mgr, vector<abstract1> &disjunction, const abstract1 &conjunct) {
+	for (vector<abstract1>::iterator iter = disjunction.begin(); iter != disjunction.end(); ) {
+		abstract1 current = *iter, added = conjunct;
+		if (current.get_environment() != added.get_environment()) {
+			environment env = AnalysisUtils::JoinEnvironments(current.get_environment(),added.get_environment());
+			current.change_environment(mgr,env);
+			added.change_environment(mgr,env);
+		}
+		if (added <= current) // nothing new
+			return;
+		if (current <= added) { // the new conjunct covers an existing one
+			iter = disjunction.erase(iter);
+			continue;
+		}
+		++iter;
+	}
+	disjunction.push_back(conjunct);
+}
+
 set<abstract1> AnalysisUtils::CrossConjunct(manager &mgr, const set<abstract1> &abs_set1, const set<abstract1> &abs_set2) {
-	set<abstract1> result;
+	vector<abstract1> result;
 	for ( set<abstract1>::iterator iter1 = abs_set1.begin(), end1 = abs_set1.end(); iter1 != end1; ++iter1 ) {
 		for ( set<abstract1>::iterator iter2 = abs_set2.begin(),end2 = abs_set2.end(); iter2 != end2; ++iter2 ) {
 			abstract1 conjunction_abs = *iter1, second_abs = *iter2;
@@ -445,12 +569,47 @@ set<abstract1> AnalysisUtils::CrossConjunct(manager &mgr, const set<abstract1> &
 			conjunction_abs.change_environment(mgr,env);
 			second_abs.change_environment(mgr,env);
 			conjunction_abs.meet(mgr,second_abs);
-			result.insert(conjunction_abs);
+			// a bottom conjunct adds nothing to the disjunction
+			if (conjunction_abs.is_bottom(mgr))
+				continue;
+			InsertUnsubsumed(mgr,result,conjunction_abs);
 		}
 	}
+	return set<abstract1>(result.begin(),result.end());
+}
+
+/**
+ * Keep the disjunction at no more than max_size abstracts by joining the surplus into a single abstract.
+ * The join over-approximates the dropped disjuncts, which only adds (potential) differences and so stays sound.
+ */
+set<abstract1> AnalysisUtils::BoundDisjunction(manager &mgr, const set<abstract1> &disjunction, size_t max_size) {
+	if (disjunction.size() <= max_size || max_size == 0)
+		return disjunction;
+	set<abstract1> result;
+	set<abstract1>::const_iterator iter = disjunction.begin(), end = disjunction.end();
+	for (size_t i = 0; i + 1 < max_size; ++i, ++iter)
+		result.insert(*iter);
+	abstract1 joined = *iter;
+	for (++iter; iter != end; ++iter) {
+		abstract1 current = *iter;
+		environment env = AnalysisUtils::JoinEnvironments(joined.get_environment(),current.get_environment());
+		joined.change_environment(mgr,env);
+		current.change_environment(mgr,env);
+		joined.join(mgr,current);
+	}
+	result.insert(joined);
 	return result;
 }
 
+namespace {
+// orders groups of abstracts by size, smallest first
+struct SmallerGroup {
+	bool operator()(const set<abstract1> &left, const set<abstract1> &right) const {
+		return left.size() < right.size();
+	}
+};
+}
+
 set<abstract1> AnalysisUtils::CrossConjunctAbstracts(manager &mgr, vector<set<abstract1> > negated_tau) {
 #if (VVERBOSE)
 	cout << "\nCross Conjuncting:";
@@ -465,38 +624,156 @@ set<abstract1> AnalysisUtils::CrossConjunctAbstracts(manager &mgr, vector<set<ab
 #endif
 	if (negated_tau.empty()) // Conjunction with the empty set (i.e. false) results in an empty set
 		return set<abstract1>();
-	// Start off Phi as the last group of abstracts from Tau_Neg
-	set<abstract1> phi = negated_tau.back();
-	negated_tau.pop_back();
-	while ( !negated_tau.empty() ) {
+
+	/**
+	 * Prune the groups before crossing them:
+	 * - bottoms are dropped from each group, a group left empty is false and so is the whole conjunction.
+	 * - a group holding top is true, conjuncting with it changes nothing so it is skipped.
+	 * All abstracts in the result are brought to the environment of all groups.
+	 */
+	environment phi_env;
+	vector<set<abstract1> > groups;
+	for (size_t i = 0 ; i < negated_tau.size(); ++i) {
+		set<abstract1> group;
+		bool is_top = false;
+		for (set<abstract1>::const_iterator iter = negated_tau[i].begin(), end = negated_tau[i].end(); iter != end; ++iter) {
+			phi_env = AnalysisUtils::JoinEnvironments(phi_env,iter->get_environment());
+			if (iter->is_bottom(mgr))
+				continue;
+			if (iter->is_top(mgr))
+				is_top = true;
+			group.insert(*iter);
+		}
+		if (group.empty())
+			return set<abstract1>();
+		if (!is_top)
+			groups.push_back(group);
+	}
+	if (groups.empty()) {
+		set<abstract1> result;
+		result.insert(abstract1(mgr,phi_env,apron::top()));
+		return result;
+	}
+
+	// crossing the smaller groups first keeps the intermediate results small
+	stable_sort(groups.begin(),groups.end(),SmallerGroup());
+
+	set<abstract1> phi = BoundDisjunction(mgr,groups.front(),kMaxCrossConjunctionSize);
+	for (size_t i = 1; i < groups.size() && !phi.empty(); ++i) {
 #if (VVVERBOSE)
 		cout << "Phi So Far:";
 		for (set<abstract1>::const_iterator iter = phi.begin(), end = phi.end(); iter != end; ++iter)
 			cout << *iter << " V ";
 		cout << endl;
 #endif
-
-		// cross-conjunct the (new) last group of abstracts from Tau_neg and Tau_neg_guards
-		// with the already computed cross-conjunction in Phi
-		phi = CrossConjunct(mgr,phi,negated_tau.back());
-
+		// cross-conjunct the next group of abstracts with the already computed cross-conjunction in Phi
+		phi = BoundDisjunction(mgr,CrossConjunct(mgr,phi,groups[i]),kMaxCrossConjunctionSize);
 #if (VERBOSE)
 		cerr << "Cross Conjunction so far holds " << phi.size() << " abstracts.\n";
 #endif
-		// Again, remove the last groups of abstracts (we're done incorporating it into Phi)
-		negated_tau.pop_back();
+	}
+
+	set<abstract1> result;
+	for (set<abstract1>::const_iterator iter = phi.begin(), end = phi.end(); iter != end; ++iter) {
+		abstract1 abs = *iter;
+		abs.change_environment(mgr,phi_env);
+		result.insert(abs);
 	}
 #if (VVERBOSE)
 		cout << "Result:";
-		for (set<abstract1>::const_iterator iter = phi.begin(), end = phi.end(); iter != end; ++iter)
+		for (set<abstract1>::const_iterator iter = result.begin(), end = result.end(); iter != end; ++iter)
 			cout << *iter << " V ";
 		cout << endl;
 #endif
-	return phi;
+	return result;
 }
 
 
-set<abstract1> AnalysisUtils::MinimizeResult(manager &mgr, vector<abstract1> &result) {
+namespace {
+
+/**
+ * A cheap signature of an abstract, used to rule out containment before the domain check:
+ * if A <= B then the box of A is contained in the box of B, and so B has at least as many unbounded sides as A.
+ * The signature is only used if the box was computed exactly.
+ */
+struct ContainmentSignature {
+	bool exact;
+	unsigned unbounded;
+	vector<interval> box;
+	ContainmentSignature() : exact(false), unbounded(0) { }
+};
+
+bool BoxIncluded(const ContainmentSignature &sig, const ContainmentSignature &sig2) {
+	for (size_t d = 0; d < sig.box.size(); ++d) {
+		if (!(sig.box[d] <= sig2.box[d]))
+			return false;
+	}
+	return true;
+}
+
+struct FewerUnbounded {
+	const vector<ContainmentSignature> &signatures;
+	FewerUnbounded(const vector<ContainmentSignature> &sigs) : signatures(sigs) { }
+	bool operator()(size_t left, size_t right) const {
+		return signatures[left].unbounded < signatures[right].unbounded;
+	}
+	bool operator()(size_t left, unsigned unbounded) const {
+		return signatures[left].unbounded < unbounded;
+	}
+};
+
+struct MinimizeArguments {
+	const vector<abstract1> *abstracts; // owned by the worker alone: never shared with another thread
+	const vector<ContainmentSignature> *signatures;
+	const vector<size_t> *by_unbounded; // indices of abstracts with an exact signature, by number of unbounded sides
+	const vector<size_t> *inexact; // indices of abstracts without an exact signature
+	vector<char> *contained;
+	size_t begin, end;
+	manager *mgr_ptr; // owned by the worker alone
+};
+
+// marks contained[i] for every abstract i in [begin,end) that is strictly contained in another abstract
+void * MinimizeRange(void * arguments) {
+	MinimizeArguments *ma = (MinimizeArguments*)arguments;
+	const vector<ContainmentSignature> &signatures = *ma->signatures;
+	const vector<size_t> &by_unbounded = *ma->by_unbounded;
+	const vector<abstract1> &abstracts = *ma->abstracts;
+	manager &mgr = *ma->mgr_ptr;
+
+	for (size_t i = ma->begin; i < ma->end; ++i) {
+		const ContainmentSignature &sig = signatures[i];
+		vector<size_t> candidates = *ma->inexact;
+		if (sig.exact) {
+			// only abstracts with at least as many unbounded sides can contain abstract i
+			vector<size_t>::const_iterator first = lower_bound(by_unbounded.begin(),by_unbounded.end(),sig.unbounded,FewerUnbounded(signatures));
+			for (; first != by_unbounded.end(); ++first) {
+				if (BoxIncluded(sig,signatures[*first]))
+					candidates.push_back(*first);
+			}
+		} else {
+			candidates.insert(candidates.end(),by_unbounded.begin(),by_unbounded.end());
+		}
+		for (vector<size_t>::const_iterator iter = candidates.begin(), end = candidates.end(); iter != end; ++iter) {
+			if (*iter == i)
+				continue;
+			if (abstracts[i].is_leq(mgr,abstracts[*iter]) && !abstracts[i].is_eq(mgr,abstracts[*iter])) {
+				(*ma->contained)[i] = true;
+				break;
+			}
+		}
+	}
+
+	return arguments;
+}
+
+}
+
+/**
+ * Remove from the result every abstract that is strictly contained in another abstract of the result.
+ * Abstracts are brought to a common environment once, containment is only checked against abstracts
+ * whose signature allows it, and for large results over a reentrant manager the checks are split between threads.
+ */
+set<abstract1> AnalysisUtils::MinimizeResult(manager &mgr, const string &manager_type, vector<abstract1> &result) {
 	set<abstract1> minimized_result;
 	environment env;
 
@@ -504,28 +781,87 @@ set<abstract1> AnalysisUtils::MinimizeResult(manager &mgr, vector<abstract1> &re
 	for (vector<abstract1>::iterator iter = result.begin(), end = result.end(); iter != end; ++iter)
 		env = AnalysisUtils::JoinEnvironments(iter->get_environment(),env);
 
-	for (vector<abstract1>::iterator iter = result.begin(), end = result.end(); iter != end; ++iter) {
-		// check for containment in other abstract
-		bool is_contained = false;
-		abstract1 current_abs = *iter;
-		current_abs.change_environment(mgr,env);
-
-		for (vector<abstract1>::iterator iter2 = result.begin(), end2 = result.end(); iter2 != end2; ++iter2) {
-			abstract1 current_abs2 = *iter2;
-			current_abs2.change_environment(mgr,env);
-			if (current_abs != current_abs2 && current_abs <= current_abs2) {
-				is_contained = true;
-				break;
+	// extend all abstracts (just once) and compute their signatures
+	const size_t size = result.size();
+	vector<abstract1> extended;
+	vector<ContainmentSignature> signatures(size);
+	vector<size_t> by_unbounded, inexact;
+	for (size_t i = 0; i < size; ++i) {
+		extended.push_back(result[i]);
+		extended[i].change_environment(mgr,env);
+		extended[i].canonicalize(mgr);
+		ContainmentSignature &sig = signatures[i];
+		if (!extended[i].is_bottom(mgr)) {
+			interval_array box = extended[i].to_box(mgr);
+			sig.exact = mgr.get_flag_exact();
+			for (size_t d = 0; d < box.size(); ++d) {
+				sig.box.push_back(box[d]);
+				sig.unbounded += (box[d].get_inf().is_infty() ? 1 : 0) + (box[d].get_sup().is_infty() ? 1 : 0);
 			}
 		}
+		if (sig.exact)
+			by_unbounded.push_back(i);
+		else
+			inexact.push_back(i);
+	}
+	stable_sort(by_unbounded.begin(),by_unbounded.end(),FewerUnbounded(signatures));
+
+	vector<char> contained(size,false);
+	MinimizeArguments arguments;
+	arguments.abstracts = &extended;
+	arguments.signatures = &signatures;
+	arguments.by_unbounded = &by_unbounded;
+	arguments.inexact = &inexact;
+	arguments.contained = &contained;
+
+	// only box, oct and dbm are known to be reentrant across managers; ppl and polka (and their
+	// combinations) are not, so separate managers do not make concurrent calls into them safe
+	bool reentrant = (manager_type == AnalysisConfiguration::kManagerTypeBox || manager_type == AnalysisConfiguration::kManagerTypeOctagon ||
+			manager_type == AnalysisConfiguration::kManagerTypeDBM);
+	long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	size_t num_threads = (num_cpus > 0) ? min((size_t)num_cpus,kMaxMinimizeThreads) : 1;
+	if (!reentrant || size < kParallelMinimizeThreshold || num_threads < 2) {
+		arguments.begin = 0;
+		arguments.end = size;
+		arguments.mgr_ptr = &mgr;
+		MinimizeRange(&arguments);
+	} else {
+		// neither the reference counts of abstracts nor the backends are thread safe, and abstracts are
+		// lazily normalized even on read-only operations, so every worker gets a manager and deep copies
+		// of its own, all made here before any thread starts and released after all of them are done
+		vector<manager*> managers(num_threads);
+		vector< vector<abstract1> > copies(num_threads);
+		for (size_t t = 0; t < num_threads; ++t) {
+			managers[t] = AnalysisConfiguration::CreateManager(manager_type);
+			for (size_t i = 0; i < size; ++i)
+				copies[t].push_back(abstract1(*managers[t],extended[i]));
+		}
+		vector<pthread_t> threads(num_threads);
+		vector<MinimizeArguments> thread_arguments(num_threads,arguments);
+		size_t chunk = (size + num_threads - 1) / num_threads;
+		for (size_t t = 0; t < num_threads; ++t) {
+			thread_arguments[t].abstracts = &copies[t];
+			thread_arguments[t].begin = min(t * chunk,size);
+			thread_arguments[t].end = min((t + 1) * chunk,size);
+			thread_arguments[t].mgr_ptr = managers[t];
+			pthread_create(&threads[t],NULL,&MinimizeRange,&thread_arguments[t]);
+		}
+		for (size_t t = 0; t < num_threads; ++t)
+			pthread_join(threads[t],NULL);
+		for (size_t t = 0; t < num_threads; ++t) {
+			copies[t].clear();
+			delete managers[t];
+		}
+	}
 
-		if (!is_contained) {
-			minimized_result.insert(current_abs);
+	// insert in the original order, so the resulting set is the same as before
+	for (size_t i = 0; i < size; ++i) {
+		if (!contained[i]) {
+			minimized_result.insert(extended[i]);
 		}
 	}
 	return minimized_result;
 }
 
 
-
 }
@@ -4,8 +4,11 @@
 #include <string>
 #include <set>
 #include <map>
+#include <vector>
 using namespace std;
 
+#include <stdint.h>
+
 #include "apronxx/apronxx.hh"
 using namespace apron;
 
@@ -28,7 +31,11 @@ public:
 
 	static const texpr1 kOne;
 	static const texpr1 kZero;
+	static const size_t kMaxCrossConjunctionSize; // above this size, cross-conjunction results are over-approximated by a join
+	static const size_t kParallelMinimizeThreshold; // results at least this big are minimized by several threads
+	static const size_t kMaxMinimizeThreads;
 
+	static uint64_t Mix(uint64_t x); // 64-bit finalizer, for fingerprints
 	static abstract1 AbsFromConstraint(manager &mgr, const tcons1 &cons);
 	static environment JoinEnvironments(const environment &env1, const environment &env2);
 	static void JoinExtendEnvironments(manager &mgr, abstract1 &abs1, abstract1 &abs2);
@@ -37,6 +44,7 @@ public:
 	static bool IsGuard(const var &v);
 	static bool IsArrayInstrumentationVar(const var &v);
 	static bool IsEquivalent(const abstract1 &abs, const var &v, const var &v_tag);
+	static map<var,size_t> EqualityClasses(const abstract1 &abs); // classes of variables related by plain (x == y, x == c) equalities
 	static tcons1 GetEquivCons(environment &env,  var v, var v_tag, VarType type = Int);
 	static pair<tcons1,tcons1> GetDiffCons(environment &env,  var v, var v_tag);
 	static abstract1 MeetEquivalence(manager &mgr, const abstract1 &abs);
@@ -50,9 +58,11 @@ public:
 	static abstract1 ForgetUnconstrained(const abstract1 &abs); // forget all unconstrained variables (v==v') in the given abstract state and environment.
 	static abstract1 ForgetUnmatched(const abstract1 &abs); // forget all variables that were removed by the patch (i.e. don't have a tagged version) or were added by the patch (i.e. don't have an untagged version). This includes guards.
 	static set<abstract1> NegateAbstract(manager &mgr, abstract1 &tau_i);
+	static void InsertUnsubsumed(manager &mgr, vector<abstract1> &disjunction, const abstract1 &conjunct);
 	static set<abstract1> CrossConjunct(manager &mgr, const set<abstract1> &abs_set1, const set<abstract1> &abs_set2);
+	static set<abstract1> BoundDisjunction(manager &mgr, const set<abstract1> &disjunction, size_t max_size);
 	static set<abstract1> CrossConjunctAbstracts(manager &mgr, vector<set<abstract1> > negated_tau);
-	static set<abstract1> MinimizeResult(manager &mgr, vector<abstract1> &result);
+	static set<abstract1> MinimizeResult(manager &mgr, const string &manager_type, vector<abstract1> &result);
 
 };
 
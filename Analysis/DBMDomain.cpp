@@ -0,0 +1,1411 @@
+/*
+ * DBMDomain.cpp
+ *
+ * A difference-bound matrix over the program variables x_1..x_n and the constant x_0 = 0.
+ * Entry m[i][j] bounds x_i - x_j <= m[i][j], so row/column 0 hold the interval bounds.
+ * Matrices are dense int64, kept closed (all-pairs shortest paths) incrementally: adding a
+ * single constraint to a closed matrix costs O(n^2), as one min-plus pass over the rows.
+ *
+ * A widening result is the one matrix that must stay unclosed: closing it tightens the bounds that
+ * the widening just dropped, and the next widening may then never stabilize. Reading one (is_leq,
+ * join, to_box, ...) therefore goes through its closure, cached next to it, and only an operation
+ * that makes a new value out of it closes it in place.
+ *
+ * All dimensions (int and real) are treated as integers, which is what the analysis assumes
+ * for the programs it handles. Constraints that are not of the form (+-x <= c) or (x - y <= c)
+ * are approximated through the interval bounds of their variables.
+ */
+
+#include "DBMDomain.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+#include "ap_generic.h"
+#include "ap_linearize.h"
+#include "pk.h"
+
+namespace differential {
+
+namespace {
+
+typedef int64_t bound_t;
+
+const bound_t kInfinity = ((bound_t)1) << 61;
+// constants beyond this magnitude are dropped (treated as unbounded), which keeps every sum
+// of bounds along a path far away from overflowing kInfinity
+const bound_t kMaxFinite = ((bound_t)1) << 40;
+
+inline bool IsInfinite(bound_t b) { return b >= kInfinity / 2; }
+
+struct dbm_t {
+	size_t intdim;
+	size_t realdim;
+	bool closed;
+	bool empty;
+	bool widened; // the result of a widening, never closed in place
+	bound_t * m; // (dim+1)x(dim+1), row major. NULL iff empty.
+	dbm_t * closure; // the closure of a widened matrix, once it was read (NULL otherwise)
+};
+
+inline size_t Dim(const dbm_t * a) { return a->intdim + a->realdim; }
+inline size_t Side(const dbm_t * a) { return Dim(a) + 1; }
+inline bound_t & At(dbm_t * a, size_t i, size_t j) { return a->m[i * Side(a) + j]; }
+inline bound_t At(const dbm_t * a, size_t i, size_t j) { return a->m[i * Side(a) + j]; }
+// apron dimension d is index d+1 in the matrix (0 is the constant)
+inline size_t Index(ap_dim_t d) { return d + 1; }
+
+void SetTop(dbm_t * a) {
+	const size_t n = Side(a);
+	for (size_t i = 0; i < n * n; ++i)
+		a->m[i] = kInfinity;
+	for (size_t i = 0; i < n; ++i)
+		At(a,i,i) = 0;
+	a->closed = true;
+}
+
+dbm_t * Alloc(size_t intdim, size_t realdim, bool empty) {
+	dbm_t * a = new dbm_t;
+	a->intdim = intdim;
+	a->realdim = realdim;
+	a->empty = empty;
+	a->closed = true;
+	a->widened = false;
+	a->m = NULL;
+	a->closure = NULL;
+	if (!empty) {
+		a->m = new bound_t[Side(a) * Side(a)];
+		SetTop(a);
+	}
+	return a;
+}
+
+void Free(dbm_t * a) {
+	if (a->closure)
+		Free(a->closure);
+	delete[] a->m;
+	delete a;
+}
+
+// a copy of the matrix, still a widening result if a was one
+dbm_t * Copy(const dbm_t * a) {
+	dbm_t * r = Alloc(a->intdim,a->realdim,a->empty);
+	if (!a->empty) {
+		memcpy(r->m,a->m,Side(a) * Side(a) * sizeof(bound_t));
+		r->closed = a->closed;
+		r->widened = a->widened;
+	}
+	return r;
+}
+
+void SetEmpty(dbm_t * a) {
+	delete[] a->m;
+	a->m = NULL;
+	a->empty = true;
+	a->closed = true;
+}
+
+// a is about to be changed into a new value, which is no longer a widening result
+void Writable(dbm_t * a) {
+	if (!a->widened)
+		return;
+	a->widened = false;
+	if (a->closure) {
+		Free(a->closure);
+		a->closure = NULL;
+	}
+}
+
+// row[j] = min(row[j], offset + other[j]). the rows never alias (callers skip the pivot row).
+inline void MinPlusRow(bound_t * __restrict__ row, const bound_t * __restrict__ other, bound_t offset, size_t n) {
+	for (size_t j = 0; j < n; ++j) {
+		bound_t candidate = offset + other[j];
+		row[j] = (candidate < row[j]) ? candidate : row[j];
+	}
+}
+
+// sums involving kInfinity may land slightly below it; snap them back and look for negative cycles
+void Normalize(dbm_t * a) {
+	const size_t n = Side(a);
+	bound_t * m = a->m;
+	for (size_t i = 0; i < n * n; ++i)
+		m[i] = IsInfinite(m[i]) ? kInfinity : m[i];
+	for (size_t i = 0; i < n; ++i) {
+		if (m[i * n + i] < 0) {
+			SetEmpty(a);
+			return;
+		}
+	}
+}
+
+// Floyd-Warshall
+void Close(dbm_t * a) {
+	if (a->empty || a->closed)
+		return;
+	const size_t n = Side(a);
+	bound_t * m = a->m;
+	for (size_t k = 0; k < n; ++k) {
+		const bound_t * row_k = m + k * n;
+		for (size_t i = 0; i < n; ++i) {
+			bound_t m_ik = m[i * n + k];
+			if (i == k || IsInfinite(m_ik))
+				continue;
+			MinPlusRow(m + i * n,row_k,m_ik,n);
+		}
+		if (m[k * n + k] < 0) {
+			SetEmpty(a);
+			return;
+		}
+	}
+	a->closed = true;
+	Normalize(a);
+}
+
+/**
+ * The closed matrix to read a from: a itself, closed in place, or for a widening result its cached closure.
+ */
+dbm_t * Closure(dbm_t * a) {
+	if (!a->widened) {
+		Close(a);
+		return a;
+	}
+	if (!a->closure) {
+		a->closure = Copy(a);
+		a->closure->widened = false;
+		Close(a->closure);
+	}
+	return a->closure;
+}
+
+/**
+ * Add (x_i - x_j <= c). On a closed matrix, the only new shortest paths are the ones going
+ * through the new edge, so a single min-plus pass over the rows keeps the matrix closed.
+ */
+void AddConstraint(dbm_t * a, size_t i, size_t j, bound_t c) {
+	if (a->empty || c >= kMaxFinite)
+		return;
+	if (c < -kMaxFinite)
+		c = -kMaxFinite;
+	if (c >= At(a,i,j))
+		return;
+	if (!a->closed) {
+		At(a,i,j) = c;
+		return;
+	}
+	if (!IsInfinite(At(a,j,i)) && At(a,j,i) + c < 0) {
+		SetEmpty(a);
+		return;
+	}
+	const size_t n = Side(a);
+	bound_t * m = a->m;
+	const bound_t * row_j = m + j * n;
+	for (size_t k = 0; k < n; ++k) {
+		bound_t m_ki = m[k * n + i];
+		if (k == j || IsInfinite(m_ki))
+			continue;
+		MinPlusRow(m + k * n,row_j,m_ki + c,n);
+	}
+	Normalize(a);
+}
+
+// drop all constraints on x_i. forgetting keeps a closed matrix closed.
+void ForgetIndex(dbm_t * a, size_t i) {
+	const size_t n = Side(a);
+	for (size_t k = 0; k < n; ++k) {
+		if (k == i)
+			continue;
+		At(a,i,k) = kInfinity;
+		At(a,k,i) = kInfinity;
+	}
+}
+
+bound_t UpperBound(double v, bool integer) {
+	if (v >= (double)kMaxFinite)
+		return kInfinity;
+	if (v <= -(double)kMaxFinite)
+		return -kMaxFinite;
+	// allow for rounding noise in the linearized constants before rounding down
+	return (bound_t)(integer ? floor(v + 1e-9) : ceil(v));
+}
+
+double ToDouble(bound_t b) {
+	return IsInfinite(b) ? INFINITY : (double)b;
+}
+
+void CoeffToInterval(ap_coeff_t * coeff, double &low, double &high) {
+	if (coeff->discr == AP_COEFF_SCALAR) {
+		ap_double_set_scalar(&low,coeff->val.scalar,GMP_RNDD);
+		ap_double_set_scalar(&high,coeff->val.scalar,GMP_RNDU);
+	} else {
+		ap_double_set_scalar(&low,coeff->val.interval->inf,GMP_RNDD);
+		ap_double_set_scalar(&high,coeff->val.interval->sup,GMP_RNDU);
+	}
+}
+
+// [low,high] of x_i as read off a closed matrix
+void BoundsOf(const dbm_t * a, size_t i, double &low, double &high) {
+	high = ToDouble(At(a,i,0));
+	low = -ToDouble(At(a,0,i));
+}
+
+double MulLow(double a_low, double a_high, double b_low, double b_high) {
+	double r = INFINITY;
+	double p[4] = { a_low * b_low, a_low * b_high, a_high * b_low, a_high * b_high };
+	for (size_t i = 0; i < 4; ++i)
+		if (p[i] == p[i] && p[i] < r) // skip NaN (0 * inf is 0 here)
+			r = p[i];
+	return (r == INFINITY && a_low == 0 && a_high == 0) ? 0 : r;
+}
+
+double MulHigh(double a_low, double a_high, double b_low, double b_high) {
+	return -MulLow(a_low,a_high,-b_high,-b_low);
+}
+
+// interval evaluation of a linear expression over the bounds of a (closed, non empty) matrix
+void EvalLinexpr(const dbm_t * a, ap_linexpr0_t * e, double &low, double &high) {
+	CoeffToInterval(&e->cst,low,high);
+	size_t k;
+	ap_dim_t dim;
+	ap_coeff_t * coeff;
+	ap_linexpr0_ForeachLinterm(e,k,dim,coeff) {
+		if (ap_coeff_zero(coeff))
+			continue;
+		double c_low, c_high, x_low, x_high;
+		CoeffToInterval(coeff,c_low,c_high);
+		BoundsOf(a,Index(dim),x_low,x_high);
+		if (c_low == 0 && c_high == 0)
+			continue;
+		low += MulLow(c_low,c_high,x_low,x_high);
+		high += MulHigh(c_low,c_high,x_low,x_high);
+	}
+}
+
+/**
+ * Meet with (e >= 0). Unit differences and bounds are added exactly; anything else only
+ * contributes the variable bounds it implies given the bounds of the other variables.
+ */
+bool MeetSupEq(dbm_t * a, ap_linexpr0_t * e, bool strict) {
+	double cst_low, cst_high;
+	CoeffToInterval(&e->cst,cst_low,cst_high);
+	if (cst_high == INFINITY)
+		return true; // always satisfiable
+	bool integer = true;
+	vector<ap_dim_t> dims;
+	vector<double> coeffs;
+	size_t k;
+	ap_dim_t dim;
+	ap_coeff_t * coeff;
+	ap_linexpr0_ForeachLinterm(e,k,dim,coeff) {
+		if (ap_coeff_zero(coeff))
+			continue;
+		if (coeff->discr != AP_COEFF_SCALAR)
+			return false; // interval coefficients: drop the constraint
+		double c;
+		ap_double_set_scalar(&c,coeff->val.scalar,GMP_RNDN);
+		integer = integer && (c == floor(c)) && (dim < a->intdim);
+		dims.push_back(dim);
+		coeffs.push_back(c);
+	}
+	// sum(c_k * x_k) + cst >= 0, i.e. -sum(c_k * x_k) <= cst. over the integers, -sum < cst means -sum <= ceil(cst) - 1
+	double cst = (strict && integer) ? ceil(cst_high) - 1 : cst_high;
+	if (dims.empty()) {
+		if (cst < 0 || (strict && !integer && cst <= 0))
+			SetEmpty(a);
+		return true;
+	}
+	if (dims.size() == 1 && (coeffs[0] == 1 || coeffs[0] == -1)) {
+		size_t i = Index(dims[0]);
+		if (coeffs[0] == 1)
+			AddConstraint(a,0,i,UpperBound(cst,integer)); // -x <= cst
+		else
+			AddConstraint(a,i,0,UpperBound(cst,integer)); // x <= cst
+		return true;
+	}
+	if (dims.size() == 2 && coeffs[0] == -coeffs[1] && (coeffs[0] == 1 || coeffs[0] == -1)) {
+		size_t pos = Index(coeffs[0] == 1 ? dims[0] : dims[1]);
+		size_t neg = Index(coeffs[0] == 1 ? dims[1] : dims[0]);
+		AddConstraint(a,neg,pos,UpperBound(cst,integer)); // x_neg - x_pos <= cst
+		return true;
+	}
+	// c_k * x_k >= -cst - sum_{j != k}(c_j * x_j) >= -cst - sum_{j != k}(sup(c_j * x_j))
+	Close(a);
+	if (a->empty)
+		return true;
+	vector<double> sups(dims.size());
+	double total = 0;
+	size_t unbounded = 0;
+	for (size_t k = 0; k < dims.size(); ++k) {
+		double x_low, x_high;
+		BoundsOf(a,Index(dims[k]),x_low,x_high);
+		sups[k] = (coeffs[k] > 0) ? coeffs[k] * x_high : coeffs[k] * x_low;
+		if (sups[k] == INFINITY)
+			++unbounded;
+		else
+			total += sups[k];
+	}
+	for (size_t k = 0; k < dims.size(); ++k) {
+		double rest;
+		if (sups[k] == INFINITY)
+			rest = (unbounded == 1) ? total : INFINITY;
+		else
+			rest = unbounded ? INFINITY : total - sups[k];
+		if (rest == INFINITY)
+			continue;
+		double bound = (-cst - rest) / coeffs[k];
+		size_t i = Index(dims[k]);
+		bool dim_integer = dims[k] < a->intdim;
+		if (coeffs[k] > 0)
+			AddConstraint(a,0,i,UpperBound(-bound,dim_integer)); // x >= bound
+		else
+			AddConstraint(a,i,0,UpperBound(bound,dim_integer)); // x <= bound
+	}
+	return false;
+}
+
+bool MeetLincons(dbm_t * a, ap_lincons0_t * cons) {
+	switch (cons->constyp) {
+	case AP_CONS_SUPEQ:
+		return MeetSupEq(a,cons->linexpr0,false);
+	case AP_CONS_SUP:
+		return MeetSupEq(a,cons->linexpr0,true);
+	case AP_CONS_EQ: {
+		bool exact = MeetSupEq(a,cons->linexpr0,false);
+		ap_linexpr0_t * negated = ap_linexpr0_copy(cons->linexpr0);
+		size_t k;
+		ap_dim_t dim;
+		ap_coeff_t * coeff;
+		ap_linexpr0_ForeachLinterm(negated,k,dim,coeff) {
+			ap_coeff_neg(coeff,coeff);
+		}
+		ap_coeff_neg(&negated->cst,&negated->cst);
+		exact = MeetSupEq(a,negated,false) && exact;
+		ap_linexpr0_free(negated);
+		return exact;
+	}
+	default: // DISEQ and EQMOD are not representable, ignoring them is sound
+		return false;
+	}
+}
+
+/**
+ * x_d := e, for a linearized e. Translations (x := x + c) and copies (x := y + c) are exact,
+ * anything else assigns the interval of e.
+ */
+bool AssignLinexpr(dbm_t * a, ap_dim_t d, ap_linexpr0_t * e) {
+	Close(a);
+	if (a->empty)
+		return true;
+	double cst_low, cst_high;
+	CoeffToInterval(&e->cst,cst_low,cst_high);
+	bool integer = (d < a->intdim);
+	ap_dim_t single = AP_DIM_MAX;
+	size_t terms = 0;
+	bool unit = true;
+	size_t k;
+	ap_dim_t dim;
+	ap_coeff_t * coeff;
+	ap_linexpr0_ForeachLinterm(e,k,dim,coeff) {
+		if (ap_coeff_zero(coeff))
+			continue;
+		++terms;
+		single = dim;
+		double c_low, c_high;
+		CoeffToInterval(coeff,c_low,c_high);
+		unit = unit && (c_low == 1 && c_high == 1);
+	}
+
+	size_t i = Index(d);
+	if (terms == 1 && unit && single == d) {
+		// x := x + [low,high] shifts the row and column of x
+		bound_t up = UpperBound(cst_high,integer), down = UpperBound(-cst_low,integer);
+		const size_t n = Side(a);
+		for (size_t j = 0; j < n; ++j) {
+			if (j == i)
+				continue;
+			bound_t &row = At(a,i,j), &col = At(a,j,i);
+			row = (IsInfinite(row) || IsInfinite(up)) ? kInfinity : row + up;
+			col = (IsInfinite(col) || IsInfinite(down)) ? kInfinity : col + down;
+		}
+		// when high > low the shifted matrix can lose tightness
+		a->closed = (cst_low == cst_high);
+		return true;
+	}
+
+	if (terms == 1 && unit) {
+		// x := y + [low,high]
+		size_t j = Index(single);
+		ForgetIndex(a,i);
+		AddConstraint(a,i,j,UpperBound(cst_high,integer));
+		AddConstraint(a,j,i,UpperBound(-cst_low,integer));
+		return true;
+	}
+
+	double low, high;
+	EvalLinexpr(a,e,low,high);
+	ForgetIndex(a,i);
+	AddConstraint(a,i,0,UpperBound(high,integer));
+	AddConstraint(a,0,i,UpperBound(-low,integer));
+	return terms == 0;
+}
+
+/**
+ * x_d := e backwards: the states the assignment maps into a. Translations (x := x + c) are undone
+ * exactly, anything else goes through a fresh dimension y for the value after the assignment:
+ * a[x -> y] /\ (y == e), with y projected out.
+ */
+bool SubstituteLinexpr(dbm_t * a, ap_dim_t d, ap_linexpr0_t * e) {
+	Close(a);
+	if (a->empty)
+		return true;
+	double cst_low, cst_high;
+	CoeffToInterval(&e->cst,cst_low,cst_high);
+	ap_dim_t single = AP_DIM_MAX;
+	size_t terms = 0;
+	bool unit = true;
+	size_t k;
+	ap_dim_t dim;
+	ap_coeff_t * coeff;
+	ap_linexpr0_ForeachLinterm(e,k,dim,coeff) {
+		if (ap_coeff_zero(coeff))
+			continue;
+		++terms;
+		single = dim;
+		double c_low, c_high;
+		CoeffToInterval(coeff,c_low,c_high);
+		unit = unit && (c_low == 1 && c_high == 1);
+	}
+
+	if (terms == 1 && unit && single == d) {
+		// x := x + [low,high] is undone by x := x - [low,high]
+		ap_linexpr0_t * inverse = ap_linexpr0_copy(e);
+		ap_coeff_neg(&inverse->cst,&inverse->cst);
+		bool exact = AssignLinexpr(a,d,inverse);
+		ap_linexpr0_free(inverse);
+		return exact && cst_low == cst_high;
+	}
+
+	// r: a with x_d renamed to y (the last index), x_d itself unconstrained. renaming keeps r closed.
+	const size_t n = Side(a), i = Index(d), y = n;
+	dbm_t * r = Alloc(a->intdim,a->realdim + 1,false);
+	for (size_t row = 0; row < n; ++row)
+		for (size_t col = 0; col < n; ++col)
+			At(r,row == i ? y : row,col == i ? y : col) = At(a,row,col);
+	// e - y == 0
+	ap_linexpr0_t * equation = ap_linexpr0_alloc(AP_LINEXPR_SPARSE,terms + 1);
+	size_t term = 0;
+	ap_linexpr0_ForeachLinterm(e,k,dim,coeff) {
+		if (ap_coeff_zero(coeff))
+			continue;
+		equation->p.linterm[term].dim = dim;
+		ap_coeff_set(&equation->p.linterm[term].coeff,coeff);
+		++term;
+	}
+	equation->p.linterm[term].dim = (ap_dim_t)Dim(a);
+	ap_coeff_set_scalar_int(&equation->p.linterm[term].coeff,-1);
+	ap_coeff_set(&equation->cst,&e->cst);
+	ap_lincons0_t cons = ap_lincons0_make(AP_CONS_EQ,equation,NULL);
+	MeetLincons(r,&cons);
+	ap_lincons0_clear(&cons);
+	Close(r);
+	if (r->empty) {
+		SetEmpty(a);
+	} else {
+		// projecting y out of a closed matrix keeps it closed
+		for (size_t row = 0; row < n; ++row)
+			for (size_t col = 0; col < n; ++col)
+				At(a,row,col) = At(r,row,col);
+		a->closed = true;
+	}
+	Free(r);
+	return false;
+}
+
+void FillInterval(ap_interval_t * itv, const dbm_t * a, size_t i) {
+	if (a->empty) {
+		ap_interval_set_bottom(itv);
+		return;
+	}
+	bound_t high = At(a,i,0), low = At(a,0,i);
+	if (IsInfinite(high))
+		ap_scalar_set_infty(itv->sup,1);
+	else
+		ap_scalar_set_int(itv->sup,(long)high);
+	if (IsInfinite(low))
+		ap_scalar_set_infty(itv->inf,-1);
+	else
+		ap_scalar_set_int(itv->inf,(long)-low);
+}
+
+// (coeff_i * x_i + coeff_j * x_j + cst) constype 0. index 0 stands for no variable.
+ap_lincons0_t MakeLincons(ap_constyp_t constyp, size_t i, long coeff_i, size_t j, long coeff_j, long cst) {
+	size_t size = (i ? 1 : 0) + (j ? 1 : 0);
+	ap_linexpr0_t * e = ap_linexpr0_alloc(AP_LINEXPR_SPARSE,size);
+	size_t k = 0;
+	if (i) {
+		e->p.linterm[k].dim = i - 1;
+		ap_coeff_set_scalar_int(&e->p.linterm[k].coeff,coeff_i);
+		++k;
+	}
+	if (j) {
+		e->p.linterm[k].dim = j - 1;
+		ap_coeff_set_scalar_int(&e->p.linterm[k].coeff,coeff_j);
+	}
+	ap_coeff_set_scalar_int(&e->cst,cst);
+	return ap_lincons0_make(constyp,e,NULL);
+}
+
+/**
+ * The constraints of a closed matrix: interval bounds, then differences that do not simply
+ * follow from the bounds. Tight pairs are printed as equalities (x_i - x_j + c = 0), with the
+ * lower dimension first, which is the form the textual checks on tagged variables expect.
+ */
+vector<ap_lincons0_t> Constraints(const dbm_t * a) {
+	vector<ap_lincons0_t> result;
+	const size_t n = Side(a);
+	for (size_t i = 1; i < n; ++i) {
+		bound_t high = At(a,i,0), low = At(a,0,i);
+		if (!IsInfinite(high) && !IsInfinite(low) && high == -low) {
+			result.push_back(MakeLincons(AP_CONS_EQ,i,1,0,0,(long)-high));
+			continue;
+		}
+		if (!IsInfinite(high))
+			result.push_back(MakeLincons(AP_CONS_SUPEQ,i,-1,0,0,(long)high));
+		if (!IsInfinite(low))
+			result.push_back(MakeLincons(AP_CONS_SUPEQ,i,1,0,0,(long)low));
+	}
+	for (size_t i = 1; i < n; ++i) {
+		for (size_t j = i + 1; j < n; ++j) {
+			bound_t ij = At(a,i,j), ji = At(a,j,i);
+			bool ij_implied = IsInfinite(ij) || (!IsInfinite(At(a,i,0)) && !IsInfinite(At(a,0,j)) && ij == At(a,i,0) + At(a,0,j));
+			bool ji_implied = IsInfinite(ji) || (!IsInfinite(At(a,j,0)) && !IsInfinite(At(a,0,i)) && ji == At(a,j,0) + At(a,0,i));
+			if (!IsInfinite(ij) && !IsInfinite(ji) && ij == -ji) {
+				if (!(ij_implied && ji_implied))
+					result.push_back(MakeLincons(AP_CONS_EQ,i,1,j,-1,(long)-ij));
+				continue;
+			}
+			if (!ij_implied) // x_j - x_i + ij >= 0
+				result.push_back(MakeLincons(AP_CONS_SUPEQ,i,-1,j,1,(long)ij));
+			if (!ji_implied) // x_i - x_j + ji >= 0
+				result.push_back(MakeLincons(AP_CONS_SUPEQ,i,1,j,-1,(long)ji));
+		}
+	}
+	return result;
+}
+
+void SetResult(ap_manager_t * man, bool exact) {
+	man->result.flag_exact = exact;
+	man->result.flag_best = exact;
+}
+
+//===--------------------------------------------------------------------===//
+// apron level 0 entry points
+//===--------------------------------------------------------------------===//
+
+dbm_t * dbm_copy(ap_manager_t * man, dbm_t * a) {
+	SetResult(man,true);
+	return Copy(a);
+}
+
+void dbm_free(ap_manager_t * man, dbm_t * a) {
+	Free(a);
+}
+
+size_t dbm_size(ap_manager_t * man, dbm_t * a) {
+	return a->empty ? 1 : Side(a) * Side(a);
+}
+
+void dbm_minimize(ap_manager_t * man, dbm_t * a) {
+	SetResult(man,true);
+	Closure(a);
+}
+
+void dbm_canonicalize(ap_manager_t * man, dbm_t * a) {
+	SetResult(man,true);
+	Closure(a);
+}
+
+int dbm_hash(ap_manager_t * man, dbm_t * a) {
+	a = Closure(a);
+	if (a->empty)
+		return 0;
+	int result = (int)Dim(a);
+	const size_t n = Side(a);
+	for (size_t i = 0; i < n * n; i += 1 + n / 4)
+		result = result * 31 + (int)(a->m[i] ^ (a->m[i] >> 32));
+	return result;
+}
+
+void dbm_approximate(ap_manager_t * man, dbm_t * a, int algorithm) {
+	SetResult(man,true);
+}
+
+void dbm_fprint(FILE * stream, ap_manager_t * man, dbm_t * a, char ** name_of_dim) {
+	a = Closure(a);
+	if (a->empty) {
+		fprintf(stream,"empty dbm of dim (%lu,%lu)\n",(unsigned long)a->intdim,(unsigned long)a->realdim);
+		return;
+	}
+	vector<ap_lincons0_t> constraints = Constraints(a);
+	ap_lincons0_array_t array = ap_lincons0_array_make(constraints.size());
+	for (size_t i = 0; i < constraints.size(); ++i)
+		array.p[i] = constraints[i];
+	ap_lincons0_array_fprint(stream,&array,name_of_dim);
+	ap_lincons0_array_clear(&array);
+}
+
+void dbm_fprintdiff(FILE * stream, ap_manager_t * man, dbm_t * a1, dbm_t * a2, char ** name_of_dim) {
+	fprintf(stream,"diff of 2 dbms:\n");
+	dbm_fprint(stream,man,a1,name_of_dim);
+	dbm_fprint(stream,man,a2,name_of_dim);
+}
+
+void dbm_fdump(FILE * stream, ap_manager_t * man, dbm_t * a) {
+	fprintf(stream,"dbm of dim (%lu,%lu)%s%s\n",(unsigned long)a->intdim,(unsigned long)a->realdim,
+			a->empty ? " empty" : "",a->closed ? " closed" : "");
+	if (a->empty)
+		return;
+	const size_t n = Side(a);
+	for (size_t i = 0; i < n; ++i) {
+		for (size_t j = 0; j < n; ++j) {
+			if (IsInfinite(At(a,i,j)))
+				fprintf(stream,"  +oo");
+			else
+				fprintf(stream," %4lld",(long long)At(a,i,j));
+		}
+		fprintf(stream,"\n");
+	}
+}
+
+// layout: intdim, realdim, an empty flag, then the closed matrix row by row
+const size_t kSerializedHeader = 2 * sizeof(size_t) + 1;
+
+ap_membuf_t dbm_serialize_raw(ap_manager_t * man, dbm_t * a) {
+	SetResult(man,true);
+	const dbm_t * c = Closure(a);
+	const size_t matrix = c->empty ? 0 : Side(c) * Side(c) * sizeof(bound_t);
+	ap_membuf_t buf;
+	buf.size = kSerializedHeader + matrix;
+	buf.ptr = malloc(buf.size);
+	char * p = (char*)buf.ptr;
+	memcpy(p,&c->intdim,sizeof(size_t));
+	memcpy(p + sizeof(size_t),&c->realdim,sizeof(size_t));
+	p[2 * sizeof(size_t)] = c->empty ? 1 : 0;
+	if (matrix)
+		memcpy(p + kSerializedHeader,c->m,matrix);
+	return buf;
+}
+
+dbm_t * dbm_deserialize_raw(ap_manager_t * man, void * ptr, size_t * size) {
+	SetResult(man,true);
+	const char * p = (const char*)ptr;
+	size_t intdim, realdim;
+	memcpy(&intdim,p,sizeof(size_t));
+	memcpy(&realdim,p + sizeof(size_t),sizeof(size_t));
+	dbm_t * a = Alloc(intdim,realdim,p[2 * sizeof(size_t)] != 0);
+	size_t read = kSerializedHeader;
+	if (!a->empty) {
+		const size_t matrix = Side(a) * Side(a) * sizeof(bound_t);
+		memcpy(a->m,p + kSerializedHeader,matrix);
+		read += matrix;
+	}
+	if (size)
+		*size = read;
+	return a;
+}
+
+dbm_t * dbm_bottom(ap_manager_t * man, size_t intdim, size_t realdim) {
+	SetResult(man,true);
+	return Alloc(intdim,realdim,true);
+}
+
+dbm_t * dbm_top(ap_manager_t * man, size_t intdim, size_t realdim) {
+	SetResult(man,true);
+	return Alloc(intdim,realdim,false);
+}
+
+dbm_t * dbm_of_box(ap_manager_t * man, size_t intdim, size_t realdim, ap_interval_t ** tinterval) {
+	SetResult(man,true);
+	dbm_t * a = Alloc(intdim,realdim,false);
+	for (size_t d = 0; d < intdim + realdim && !a->empty; ++d) {
+		double low, high;
+		ap_double_set_scalar(&low,tinterval[d]->inf,GMP_RNDD);
+		ap_double_set_scalar(&high,tinterval[d]->sup,GMP_RNDU);
+		if (low > high) {
+			SetEmpty(a);
+			break;
+		}
+		AddConstraint(a,Index(d),0,UpperBound(high,d < intdim));
+		AddConstraint(a,0,Index(d),UpperBound(-low,d < intdim));
+	}
+	return a;
+}
+
+ap_dimension_t dbm_dimension(ap_manager_t * man, dbm_t * a) {
+	ap_dimension_t dim;
+	dim.intdim = a->intdim;
+	dim.realdim = a->realdim;
+	return dim;
+}
+
+bool dbm_is_bottom(ap_manager_t * man, dbm_t * a) {
+	SetResult(man,true);
+	a = Closure(a);
+	return a->empty;
+}
+
+bool dbm_is_top(ap_manager_t * man, dbm_t * a) {
+	SetResult(man,true);
+	a = Closure(a);
+	if (a->empty)
+		return false;
+	const size_t n = Side(a);
+	for (size_t i = 0; i < n; ++i)
+		for (size_t j = 0; j < n; ++j)
+			if (i != j && !IsInfinite(At(a,i,j)))
+				return false;
+	return true;
+}
+
+// a closed a1 is included in a2 iff it is pointwise below the (not necessarily closed) a2
+bool dbm_is_leq(ap_manager_t * man, dbm_t * a1, dbm_t * a2) {
+	SetResult(man,true);
+	a1 = Closure(a1);
+	if (a1->empty)
+		return true;
+	a2 = Closure(a2);
+	if (a2->empty)
+		return false;
+	const size_t size = Side(a1) * Side(a1);
+	const bound_t * m1 = a1->m, * m2 = a2->m;
+	for (size_t i = 0; i < size; ++i)
+		if (m1[i] > m2[i])
+			return false;
+	return true;
+}
+
+bool dbm_is_eq(ap_manager_t * man, dbm_t * a1, dbm_t * a2) {
+	SetResult(man,true);
+	a1 = Closure(a1);
+	a2 = Closure(a2);
+	if (a1->empty || a2->empty)
+		return a1->empty == a2->empty;
+	return memcmp(a1->m,a2->m,Side(a1) * Side(a1) * sizeof(bound_t)) == 0;
+}
+
+bool dbm_is_dimension_unconstrained(ap_manager_t * man, dbm_t * a, ap_dim_t dim) {
+	SetResult(man,true);
+	a = Closure(a);
+	if (a->empty)
+		return false;
+	const size_t n = Side(a), i = Index(dim);
+	for (size_t k = 0; k < n; ++k)
+		if (k != i && (!IsInfinite(At(a,i,k)) || !IsInfinite(At(a,k,i))))
+			return false;
+	return true;
+}
+
+ap_interval_t * dbm_bound_dimension(ap_manager_t * man, dbm_t * a, ap_dim_t dim) {
+	SetResult(man,true);
+	a = Closure(a);
+	ap_interval_t * itv = ap_interval_alloc();
+	FillInterval(itv,a,Index(dim));
+	return itv;
+}
+
+ap_interval_t * dbm_bound_linexpr(ap_manager_t * man, dbm_t * a, ap_linexpr0_t * expr) {
+	SetResult(man,false);
+	a = Closure(a);
+	ap_interval_t * itv = ap_interval_alloc();
+	if (a->empty) {
+		ap_interval_set_bottom(itv);
+		return itv;
+	}
+	double low, high;
+	EvalLinexpr(a,expr,low,high);
+	ap_scalar_set_double(itv->inf,low);
+	ap_scalar_set_double(itv->sup,high);
+	return itv;
+}
+
+ap_interval_t * dbm_bound_texpr(ap_manager_t * man, dbm_t * a, ap_texpr0_t * expr) {
+	SetResult(man,false);
+	a = Closure(a);
+	if (a->empty) {
+		ap_interval_t * itv = ap_interval_alloc();
+		ap_interval_set_bottom(itv);
+		return itv;
+	}
+	bool exact;
+	ap_linexpr0_t * e = ap_intlinearize_texpr0(man,a,expr,&exact,AP_SCALAR_DOUBLE,false);
+	ap_interval_t * itv = dbm_bound_linexpr(man,a,e);
+	ap_linexpr0_free(e);
+	return itv;
+}
+
+bool dbm_sat_interval(ap_manager_t * man, dbm_t * a, ap_dim_t dim, ap_interval_t * interval) {
+	SetResult(man,true);
+	a = Closure(a);
+	if (a->empty)
+		return true;
+	ap_interval_t * itv = ap_interval_alloc();
+	FillInterval(itv,a,Index(dim));
+	bool result = ap_interval_is_leq(itv,interval);
+	ap_interval_free(itv);
+	return result;
+}
+
+// e is (x_pos - x_neg + cst) for a scalar cst, i.e. a unit difference the matrix holds an entry for
+bool IsUnitDifference(ap_linexpr0_t * e, size_t &pos, size_t &neg) {
+	if (e->cst.discr != AP_COEFF_SCALAR)
+		return false;
+	size_t count = 0, k;
+	ap_dim_t dim;
+	ap_coeff_t * coeff;
+	ap_linexpr0_ForeachLinterm(e,k,dim,coeff) {
+		if (ap_coeff_zero(coeff))
+			continue;
+		if (coeff->discr != AP_COEFF_SCALAR || ++count > 2)
+			return false;
+		if (ap_scalar_equal_int(coeff->val.scalar,1))
+			pos = Index(dim);
+		else if (ap_scalar_equal_int(coeff->val.scalar,-1))
+			neg = Index(dim);
+		else
+			return false;
+	}
+	return count == 2 && pos != neg;
+}
+
+// sound but incomplete: only answers true when the bounds (or, for a unit difference, its matrix entries) prove the constraint
+bool dbm_sat_lincons(ap_manager_t * man, dbm_t * a, ap_lincons0_t * cons) {
+	SetResult(man,false);
+	a = Closure(a);
+	if (a->empty)
+		return true;
+	double low, high;
+	EvalLinexpr(a,cons->linexpr0,low,high);
+	size_t pos = 0, neg = 0;
+	if (IsUnitDifference(cons->linexpr0,pos,neg)) { // -m[neg][pos] <= x_pos - x_neg <= m[pos][neg]
+		double cst_low, cst_high;
+		CoeffToInterval(&cons->linexpr0->cst,cst_low,cst_high);
+		low = max(low,-ToDouble(At(a,neg,pos)) + cst_low);
+		high = min(high,ToDouble(At(a,pos,neg)) + cst_high);
+	}
+	switch (cons->constyp) {
+	case AP_CONS_SUPEQ:
+		return low >= 0;
+	case AP_CONS_SUP:
+		return low > 0;
+	case AP_CONS_EQ:
+		return low == 0 && high == 0;
+	case AP_CONS_DISEQ:
+		return low > 0 || high < 0;
+	default:
+		return false;
+	}
+}
+
+bool dbm_sat_tcons(ap_manager_t * man, dbm_t * a, ap_tcons0_t * cons) {
+	SetResult(man,false);
+	a = Closure(a);
+	if (a->empty)
+		return true;
+	bool exact;
+	ap_lincons0_t lincons;
+	lincons.linexpr0 = ap_intlinearize_texpr0(man,a,cons->texpr0,&exact,AP_SCALAR_DOUBLE,false);
+	lincons.constyp = cons->constyp;
+	lincons.scalar = NULL;
+	bool result = dbm_sat_lincons(man,a,&lincons);
+	ap_linexpr0_free(lincons.linexpr0);
+	return result;
+}
+
+ap_interval_t ** dbm_to_box(ap_manager_t * man, dbm_t * a) {
+	SetResult(man,true);
+	a = Closure(a);
+	ap_interval_t ** box = ap_interval_array_alloc(Dim(a));
+	for (size_t d = 0; d < Dim(a); ++d)
+		FillInterval(box[d],a,Index(d));
+	return box;
+}
+
+ap_lincons0_array_t dbm_to_lincons_array(ap_manager_t * man, dbm_t * a) {
+	SetResult(man,true);
+	a = Closure(a);
+	if (a->empty) {
+		ap_lincons0_array_t array = ap_lincons0_array_make(1);
+		array.p[0] = ap_lincons0_make_unsat();
+		return array;
+	}
+	vector<ap_lincons0_t> constraints = Constraints(a);
+	ap_lincons0_array_t array = ap_lincons0_array_make(constraints.size());
+	for (size_t i = 0; i < constraints.size(); ++i)
+		array.p[i] = constraints[i];
+	return array;
+}
+
+ap_tcons0_array_t dbm_to_tcons_array(ap_manager_t * man, dbm_t * a) {
+	ap_lincons0_array_t lincons = dbm_to_lincons_array(man,a);
+	ap_tcons0_array_t array = ap_tcons0_array_make(lincons.size);
+	for (size_t i = 0; i < lincons.size; ++i)
+		array.p[i] = ap_tcons0_from_lincons0(&lincons.p[i]);
+	ap_lincons0_array_clear(&lincons);
+	return array;
+}
+
+// a zone is a (rational) polyhedron, so its generators are the ones polka finds for its constraints
+ap_generator0_array_t dbm_to_generator_array(ap_manager_t * man, dbm_t * a) {
+	dbm_t * c = Closure(a);
+	ap_manager_t * pk = pk_manager_alloc(false);
+	ap_abstract0_t * poly;
+	if (c->empty) {
+		poly = ap_abstract0_bottom(pk,c->intdim,c->realdim);
+	} else {
+		ap_lincons0_array_t constraints = dbm_to_lincons_array(man,c);
+		poly = ap_abstract0_of_lincons_array(pk,c->intdim,c->realdim,&constraints);
+		ap_lincons0_array_clear(&constraints);
+	}
+	ap_generator0_array_t result = ap_abstract0_to_generator_array(pk,poly);
+	ap_abstract0_free(pk,poly);
+	ap_manager_free(pk);
+	SetResult(man,true);
+	return result;
+}
+
+dbm_t * dbm_meet(ap_manager_t * man, bool destructive, dbm_t * a1, dbm_t * a2) {
+	SetResult(man,true);
+	dbm_t * r = destructive ? a1 : Copy(a1);
+	Writable(r);
+	if (r->empty)
+		return r;
+	if (a2->empty) {
+		SetEmpty(r);
+		return r;
+	}
+	const size_t size = Side(r) * Side(r);
+	bound_t * m = r->m;
+	const bound_t * m2 = a2->m;
+	for (size_t i = 0; i < size; ++i)
+		m[i] = (m2[i] < m[i]) ? m2[i] : m[i];
+	r->closed = false;
+	return r;
+}
+
+dbm_t * dbm_meet_array(ap_manager_t * man, dbm_t ** tab, size_t size) {
+	dbm_t * r = Copy(tab[0]);
+	for (size_t i = 1; i < size; ++i)
+		dbm_meet(man,true,r,tab[i]);
+	SetResult(man,true);
+	return r;
+}
+
+dbm_t * dbm_meet_lincons_array(ap_manager_t * man, bool destructive, dbm_t * a, ap_lincons0_array_t * array) {
+	dbm_t * r = destructive ? a : Copy(a);
+	Writable(r);
+	bool exact = true;
+	for (size_t i = 0; i < array->size && !r->empty; ++i)
+		exact = MeetLincons(r,&array->p[i]) && exact;
+	SetResult(man,exact);
+	return r;
+}
+
+// apron's generic linearization only hands back dbm_t values we created ourselves
+void * dbm_meet_lincons_array_void(ap_manager_t * man, bool destructive, void * a, ap_lincons0_array_t * array) {
+	return dbm_meet_lincons_array(man,destructive,(dbm_t*)a,array);
+}
+
+dbm_t * dbm_meet_tcons_array(ap_manager_t * man, bool destructive, dbm_t * a, ap_tcons0_array_t * array) {
+	return (dbm_t*)ap_generic_meet_intlinearize_tcons_array(man,destructive,a,array,AP_SCALAR_DOUBLE,
+			AP_LINEXPR_LINEAR,&dbm_meet_lincons_array_void);
+}
+
+// the join of closed matrices is their pointwise max, and is closed
+dbm_t * dbm_join(ap_manager_t * man, bool destructive, dbm_t * a1, dbm_t * a2) {
+	SetResult(man,false);
+	const dbm_t * c1 = Closure(a1), * c2 = Closure(a2);
+	if (c2->empty)
+		return destructive ? a1 : Copy(a1);
+	if (c1->empty) {
+		if (destructive)
+			Free(a1);
+		return Copy(a2);
+	}
+	dbm_t * r = destructive ? a1 : Copy(a1);
+	const size_t size = Side(r) * Side(r);
+	bound_t * m = r->m;
+	const bound_t * m1 = c1->m, * m2 = c2->m;
+	for (size_t i = 0; i < size; ++i)
+		m[i] = (m2[i] > m1[i]) ? m2[i] : m1[i];
+	Writable(r); // only now, c1 may be the cached closure of r
+	r->closed = true;
+	return r;
+}
+
+dbm_t * dbm_join_array(ap_manager_t * man, dbm_t ** tab, size_t size) {
+	dbm_t * r = Copy(tab[0]);
+	for (size_t i = 1; i < size; ++i)
+		r = dbm_join(man,true,r,tab[i]);
+	SetResult(man,false);
+	return r;
+}
+
+// adding rays is not supported, going to top is sound
+dbm_t * dbm_add_ray_array(ap_manager_t * man, bool destructive, dbm_t * a, ap_generator0_array_t * array) {
+	SetResult(man,false);
+	dbm_t * r = Alloc(a->intdim,a->realdim,a->empty);
+	if (destructive)
+		Free(a);
+	return r;
+}
+
+dbm_t * dbm_assign_linexpr_array(ap_manager_t * man, bool destructive, dbm_t * a, ap_dim_t * tdim,
+		ap_linexpr0_t ** texpr, size_t size, dbm_t * dest) {
+	if (size != 1)
+		return (dbm_t*)ap_generic_assign_linexpr_array(man,destructive,a,tdim,texpr,size,dest);
+	dbm_t * r = destructive ? a : Copy(a);
+	Writable(r);
+	bool exact = AssignLinexpr(r,tdim[0],texpr[0]);
+	if (dest)
+		dbm_meet(man,true,r,dest);
+	SetResult(man,exact);
+	return r;
+}
+
+dbm_t * dbm_assign_texpr_array(ap_manager_t * man, bool destructive, dbm_t * a, ap_dim_t * tdim,
+		ap_texpr0_t ** texpr, size_t size, dbm_t * dest) {
+	if (size != 1)
+		return (dbm_t*)ap_generic_assign_texpr_array(man,destructive,a,tdim,texpr,size,dest);
+	dbm_t * c = Closure(a);
+	if (c->empty)
+		return destructive ? a : Copy(a);
+	bool exact;
+	ap_linexpr0_t * e = ap_intlinearize_texpr0(man,c,texpr[0],&exact,AP_SCALAR_DOUBLE,false);
+	dbm_t * r = dbm_assign_linexpr_array(man,destructive,a,tdim,&e,1,dest);
+	ap_linexpr0_free(e);
+	man->result.flag_exact = man->result.flag_exact && exact;
+	return r;
+}
+
+dbm_t * dbm_substitute_linexpr_array(ap_manager_t * man, bool destructive, dbm_t * a, ap_dim_t * tdim,
+		ap_linexpr0_t ** texpr, size_t size, dbm_t * dest) {
+	if (size != 1)
+		return (dbm_t*)ap_generic_substitute_linexpr_array(man,destructive,a,tdim,texpr,size,dest);
+	dbm_t * r = destructive ? a : Copy(a);
+	Writable(r);
+	bool exact = SubstituteLinexpr(r,tdim[0],texpr[0]);
+	if (dest)
+		dbm_meet(man,true,r,dest);
+	SetResult(man,exact);
+	return r;
+}
+
+dbm_t * dbm_substitute_texpr_array(ap_manager_t * man, bool destructive, dbm_t * a, ap_dim_t * tdim,
+		ap_texpr0_t ** texpr, size_t size, dbm_t * dest) {
+	if (size != 1)
+		return (dbm_t*)ap_generic_substitute_texpr_array(man,destructive,a,tdim,texpr,size,dest);
+	dbm_t * c = Closure(a);
+	if (c->empty)
+		return destructive ? a : Copy(a);
+	bool exact;
+	ap_linexpr0_t * e = ap_intlinearize_texpr0(man,c,texpr[0],&exact,AP_SCALAR_DOUBLE,false);
+	dbm_t * r = dbm_substitute_linexpr_array(man,destructive,a,tdim,&e,1,dest);
+	ap_linexpr0_free(e);
+	man->result.flag_exact = man->result.flag_exact && exact;
+	return r;
+}
+
+dbm_t * dbm_add_dimensions(ap_manager_t * man, bool destructive, dbm_t * a, ap_dimchange_t * dimchange, bool project) {
+	SetResult(man,true);
+	const size_t added = dimchange->intdim + dimchange->realdim;
+	dbm_t * r = Alloc(a->intdim + dimchange->intdim,a->realdim + dimchange->realdim,a->empty);
+	if (!a->empty) {
+		// new index of each old index. dimchange->dim[k] is the old dimension a new one is inserted before.
+		const size_t old_n = Side(a);
+		vector<size_t> moved(old_n);
+		moved[0] = 0;
+		size_t k = 0;
+		for (size_t d = 0; d < Dim(a); ++d) {
+			while (k < added && dimchange->dim[k] <= d)
+				++k;
+			moved[Index(d)] = Index(d + k);
+		}
+		for (size_t i = 0; i < old_n; ++i)
+			for (size_t j = 0; j < old_n; ++j)
+				At(r,moved[i],moved[j]) = At(a,i,j);
+		r->closed = a->closed;
+		r->widened = a->widened && !project;
+		if (project) {
+			// the new dimensions are set to 0
+			vector<bool> is_old(Side(r),false);
+			for (size_t i = 0; i < old_n; ++i)
+				is_old[moved[i]] = true;
+			for (size_t i = 1; i < Side(r); ++i) {
+				if (!is_old[i]) {
+					AddConstraint(r,i,0,0);
+					AddConstraint(r,0,i,0);
+				}
+			}
+		}
+	}
+	if (destructive)
+		Free(a);
+	return r;
+}
+
+dbm_t * dbm_remove_dimensions(ap_manager_t * man, bool destructive, dbm_t * a, ap_dimchange_t * dimchange) {
+	SetResult(man,true);
+	const dbm_t * c = Closure(a);
+	const size_t removed = dimchange->intdim + dimchange->realdim;
+	dbm_t * r = Alloc(a->intdim - dimchange->intdim,a->realdim - dimchange->realdim,c->empty);
+	if (!c->empty) {
+		vector<size_t> kept;
+		kept.push_back(0);
+		size_t k = 0;
+		for (size_t d = 0; d < Dim(a); ++d) {
+			if (k < removed && dimchange->dim[k] == d) {
+				++k;
+				continue;
+			}
+			kept.push_back(Index(d));
+		}
+		for (size_t i = 0; i < kept.size(); ++i)
+			for (size_t j = 0; j < kept.size(); ++j)
+				At(r,i,j) = At(c,kept[i],kept[j]);
+		r->closed = true;
+	}
+	if (destructive)
+		Free(a);
+	return r;
+}
+
+dbm_t * dbm_permute_dimensions(ap_manager_t * man, bool destructive, dbm_t * a, ap_dimperm_t * perm) {
+	SetResult(man,true);
+	dbm_t * r = Alloc(a->intdim,a->realdim,a->empty);
+	if (!a->empty) {
+		const size_t n = Side(a);
+		vector<size_t> moved(n);
+		moved[0] = 0;
+		for (size_t d = 0; d < Dim(a); ++d)
+			moved[Index(d)] = Index(perm->dim[d]);
+		for (size_t i = 0; i < n; ++i)
+			for (size_t j = 0; j < n; ++j)
+				At(r,moved[i],moved[j]) = At(a,i,j);
+		r->closed = a->closed;
+		r->widened = a->widened;
+	}
+	if (destructive)
+		Free(a);
+	return r;
+}
+
+dbm_t * dbm_forget_array(ap_manager_t * man, bool destructive, dbm_t * a, ap_dim_t * tdim, size_t size, bool project) {
+	SetResult(man,true);
+	dbm_t * r = destructive ? a : Copy(a);
+	Writable(r);
+	Close(r);
+	if (r->empty)
+		return r;
+	for (size_t k = 0; k < size; ++k)
+		ForgetIndex(r,Index(tdim[k]));
+	if (project) {
+		for (size_t k = 0; k < size; ++k) {
+			AddConstraint(r,Index(tdim[k]),0,0);
+			AddConstraint(r,0,Index(tdim[k]),0);
+		}
+	}
+	return r;
+}
+
+/**
+ * Add n copies of dim at the end of the integer (or real) dimensions. Each copy has the constraints of
+ * dim with the other dimensions, and only what those imply with dim and the other copies.
+ */
+dbm_t * dbm_expand(ap_manager_t * man, bool destructive, dbm_t * a, ap_dim_t dim, size_t n) {
+	SetResult(man,true);
+	const dbm_t * c = Closure(a);
+	const bool integer = dim < a->intdim;
+	dbm_t * r = Alloc(a->intdim + (integer ? n : 0),a->realdim + (integer ? 0 : n),c->empty);
+	if (!c->empty) {
+		// the real dimensions move up when integer ones are added
+		const size_t old_n = Side(c), source = Index(dim), first = integer ? Index(a->intdim) : old_n;
+		vector<size_t> moved(old_n);
+		for (size_t i = 0; i < old_n; ++i)
+			moved[i] = (integer && i >= first) ? i + n : i;
+		for (size_t i = 0; i < old_n; ++i)
+			for (size_t j = 0; j < old_n; ++j)
+				At(r,moved[i],moved[j]) = At(c,i,j);
+		for (size_t copy = first; copy < first + n; ++copy) {
+			for (size_t i = 0; i < old_n; ++i) {
+				if (i == source)
+					continue;
+				At(r,copy,moved[i]) = At(c,source,i);
+				At(r,moved[i],copy) = At(c,i,source);
+			}
+		}
+		r->closed = false;
+	}
+	if (destructive)
+		Free(a);
+	return r;
+}
+
+// tdim[0] gets the join of the constraints of all of tdim with the other dimensions, tdim[1..] are removed
+dbm_t * dbm_fold(ap_manager_t * man, bool destructive, dbm_t * a, ap_dim_t * tdim, size_t size) {
+	const dbm_t * c = Closure(a);
+	dbm_t * folded = Copy(c);
+	if (!folded->empty) {
+		const size_t n = Side(folded), target = Index(tdim[0]);
+		vector<bool> is_folded(n,false);
+		for (size_t k = 0; k < size; ++k)
+			is_folded[Index(tdim[k])] = true;
+		for (size_t j = 0; j < n; ++j) {
+			if (is_folded[j])
+				continue;
+			for (size_t k = 1; k < size; ++k) {
+				const size_t source = Index(tdim[k]);
+				At(folded,target,j) = max(At(folded,target,j),At(c,source,j));
+				At(folded,j,target) = max(At(folded,j,target),At(c,j,source));
+			}
+		}
+		folded->closed = false;
+	}
+	size_t intdim = 0;
+	for (size_t k = 1; k < size; ++k)
+		intdim += (tdim[k] < a->intdim) ? 1 : 0;
+	ap_dimchange_t * dimchange = ap_dimchange_alloc(intdim,size - 1 - intdim);
+	for (size_t k = 1; k < size; ++k)
+		dimchange->dim[k - 1] = tdim[k];
+	dbm_t * r = dbm_remove_dimensions(man,true,folded,dimchange);
+	ap_dimchange_free(dimchange);
+	if (destructive)
+		Free(a);
+	SetResult(man,false);
+	return r;
+}
+
+/**
+ * Standard widening: keep the bounds of a1 that are stable in (the closure of) a2. a1 is read as is
+ * when it is itself a widening result, and closed otherwise. The result is left unclosed, and is
+ * only ever read through its closure (see Closure).
+ */
+dbm_t * dbm_widening(ap_manager_t * man, dbm_t * a1, dbm_t * a2) {
+	SetResult(man,false);
+	const dbm_t * c2 = Closure(a2);
+	if (Closure(a1)->empty)
+		return Copy(a2);
+	if (c2->empty)
+		return Copy(a1);
+	dbm_t * r = Copy(a1);
+	const size_t size = Side(r) * Side(r);
+	bound_t * m = r->m;
+	const bound_t * m2 = c2->m;
+	for (size_t i = 0; i < size; ++i)
+		m[i] = (m2[i] <= m[i]) ? m[i] : kInfinity;
+	r->closed = false;
+	r->widened = true;
+	return r;
+}
+
+dbm_t * dbm_closure(ap_manager_t * man, bool destructive, dbm_t * a) {
+	SetResult(man,true);
+	dbm_t * r = destructive ? a : Copy(a);
+	Writable(r);
+	Close(r);
+	return r;
+}
+
+template <typename F>
+void Register(ap_manager_t * man, ap_funid_t funid, F f) {
+	man->funptr[funid] = (void*)f;
+}
+
+ap_manager_t * dbm_manager_alloc() {
+	ap_manager_t * man = ap_manager_alloc(DBMManager::kLibrary,DBMManager::kVersion,NULL,NULL);
+	Register(man,AP_FUNID_COPY,&dbm_copy);
+	Register(man,AP_FUNID_FREE,&dbm_free);
+	Register(man,AP_FUNID_ASIZE,&dbm_size);
+	Register(man,AP_FUNID_MINIMIZE,&dbm_minimize);
+	Register(man,AP_FUNID_CANONICALIZE,&dbm_canonicalize);
+	Register(man,AP_FUNID_HASH,&dbm_hash);
+	Register(man,AP_FUNID_APPROXIMATE,&dbm_approximate);
+	Register(man,AP_FUNID_FPRINT,&dbm_fprint);
+	Register(man,AP_FUNID_FPRINTDIFF,&dbm_fprintdiff);
+	Register(man,AP_FUNID_FDUMP,&dbm_fdump);
+	Register(man,AP_FUNID_SERIALIZE_RAW,&dbm_serialize_raw);
+	Register(man,AP_FUNID_DESERIALIZE_RAW,&dbm_deserialize_raw);
+	Register(man,AP_FUNID_BOTTOM,&dbm_bottom);
+	Register(man,AP_FUNID_TOP,&dbm_top);
+	Register(man,AP_FUNID_OF_BOX,&dbm_of_box);
+	Register(man,AP_FUNID_DIMENSION,&dbm_dimension);
+	Register(man,AP_FUNID_IS_BOTTOM,&dbm_is_bottom);
+	Register(man,AP_FUNID_IS_TOP,&dbm_is_top);
+	Register(man,AP_FUNID_IS_LEQ,&dbm_is_leq);
+	Register(man,AP_FUNID_IS_EQ,&dbm_is_eq);
+	Register(man,AP_FUNID_IS_DIMENSION_UNCONSTRAINED,&dbm_is_dimension_unconstrained);
+	Register(man,AP_FUNID_SAT_INTERVAL,&dbm_sat_interval);
+	Register(man,AP_FUNID_SAT_LINCONS,&dbm_sat_lincons);
+	Register(man,AP_FUNID_SAT_TCONS,&dbm_sat_tcons);
+	Register(man,AP_FUNID_BOUND_DIMENSION,&dbm_bound_dimension);
+	Register(man,AP_FUNID_BOUND_LINEXPR,&dbm_bound_linexpr);
+	Register(man,AP_FUNID_BOUND_TEXPR,&dbm_bound_texpr);
+	Register(man,AP_FUNID_TO_BOX,&dbm_to_box);
+	Register(man,AP_FUNID_TO_LINCONS_ARRAY,&dbm_to_lincons_array);
+	Register(man,AP_FUNID_TO_TCONS_ARRAY,&dbm_to_tcons_array);
+	Register(man,AP_FUNID_TO_GENERATOR_ARRAY,&dbm_to_generator_array);
+	Register(man,AP_FUNID_MEET,&dbm_meet);
+	Register(man,AP_FUNID_MEET_ARRAY,&dbm_meet_array);
+	Register(man,AP_FUNID_MEET_LINCONS_ARRAY,&dbm_meet_lincons_array);
+	Register(man,AP_FUNID_MEET_TCONS_ARRAY,&dbm_meet_tcons_array);
+	Register(man,AP_FUNID_JOIN,&dbm_join);
+	Register(man,AP_FUNID_JOIN_ARRAY,&dbm_join_array);
+	Register(man,AP_FUNID_ADD_RAY_ARRAY,&dbm_add_ray_array);
+	Register(man,AP_FUNID_ASSIGN_LINEXPR_ARRAY,&dbm_assign_linexpr_array);
+	Register(man,AP_FUNID_SUBSTITUTE_LINEXPR_ARRAY,&dbm_substitute_linexpr_array);
+	Register(man,AP_FUNID_ASSIGN_TEXPR_ARRAY,&dbm_assign_texpr_array);
+	Register(man,AP_FUNID_SUBSTITUTE_TEXPR_ARRAY,&dbm_substitute_texpr_array);
+	Register(man,AP_FUNID_ADD_DIMENSIONS,&dbm_add_dimensions);
+	Register(man,AP_FUNID_REMOVE_DIMENSIONS,&dbm_remove_dimensions);
+	Register(man,AP_FUNID_PERMUTE_DIMENSIONS,&dbm_permute_dimensions);
+	Register(man,AP_FUNID_FORGET_ARRAY,&dbm_forget_array);
+	Register(man,AP_FUNID_EXPAND,&dbm_expand);
+	Register(man,AP_FUNID_FOLD,&dbm_fold);
+	Register(man,AP_FUNID_WIDENING,&dbm_widening);
+	Register(man,AP_FUNID_CLOSURE,&dbm_closure);
+	for (int i = 0; i < AP_EXC_SIZE; ++i)
+		ap_manager_set_abort_if_exception(man,(ap_exc_t)i,false);
+	return man;
+}
+
+} // end anonymous namespace
+
+const char * DBMManager::kLibrary = "dbm";
+const char * DBMManager::kVersion = "1.0";
+
+DBMManager::DBMManager() : manager(dbm_manager_alloc()) { }
+
+bool DBMManager::IsDBMManager(manager &mgr) {
+	return strcmp(mgr.get_ap_manager_t()->library,kLibrary) == 0;
+}
+
+/**
+ * (v == v') holds iff the bounds on v - v' rule out the diff constraints of AnalysisUtils::GetDiffCons:
+ * (v - v' >= 1) and (v - v' <= -1), or for guards (v - v' == 1) and (v - v' == -1).
+ */
+bool DBMManager::IsEquivalent(const abstract1 &abs, const var &v, const var &v_tag, bool guards) {
+	environment env = abs.get_environment();
+	dbm_t * a = Closure((dbm_t*)abs.get_abstract0().get_ap_abstract0_t()->value);
+	if (a->empty)
+		return true;
+	size_t i = Index(env.get_dim(v)), j = Index(env.get_dim(v_tag));
+	bound_t high = At(a,i,j), low = IsInfinite(At(a,j,i)) ? -kInfinity : -At(a,j,i); // low <= v - v' <= high
+	if (guards)
+		return (high < 1 || low > 1) && (high < -1 || low > -1);
+	return high <= 0 && low >= 0;
+}
+
+}
@@ -0,0 +1,32 @@
+/*
+ * DBMDomain.h
+ *
+ * A native difference-bound matrix (zone) domain, exposed as an apron library so it can be picked
+ * through AnalysisConfiguration::ParseManager like any other manager.
+ * Most of the constraints we care about are (v - v' <= c) and interval bounds, which a DBM
+ * represents exactly at a fraction of the cost of polyhedra.
+ */
+
+#ifndef DBM_DOMAIN_H
+#define DBM_DOMAIN_H
+
+#include "apronxx/apronxx.hh"
+using namespace apron;
+
+namespace differential {
+
+class DBMManager : public manager {
+public:
+	static const char * kLibrary;
+	static const char * kVersion;
+
+	DBMManager();
+
+	static bool IsDBMManager(manager &mgr);
+	// fast equivalence check for (v == v'), reading the bounds on v - v' straight off the matrix
+	static bool IsEquivalent(const abstract1 &abs, const var &v, const var &v_tag, bool guards = false);
+};
+
+}
+
+#endif // DBM_DOMAIN_H
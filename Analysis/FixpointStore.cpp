@@ -0,0 +1,230 @@
+/*
+ * FixpointStore.cpp
+ */
+
+#include "FixpointStore.h"
+#include "AnalysisUtils.h"
+#include "TransferFuncs.h"
+#include "VariablePacks.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include <llvm/Support/raw_ostream.h>
+
+namespace differential {
+
+string FixpointStore::directory_;
+
+static void WriteName(ostream &os, const string &name) {
+	os << name.size() << ' ' << name << ' ';
+}
+
+// names may hold spaces (e.g. read instrumentation), so they are written with their length
+static string ReadName(istream &is) {
+	size_t size = 0;
+	is >> size;
+	is.get();
+	string name(size,' ');
+	if (size)
+		is.read(&name[0],size);
+	return name;
+}
+
+// exact, so that a reloaded fixpoint is the very same abstract
+static bool ScalarString(ap_scalar_t * scalar, string &result) {
+	if (ap_scalar_infty(scalar))
+		return false;
+	if (scalar->discr == AP_SCALAR_MPQ) {
+		result = mpq_class(scalar->val.mpq).get_str();
+	} else {
+		double value;
+		ap_double_set_scalar(&value,scalar,GMP_RNDN);
+		result = mpq_class(value).get_str();
+	}
+	return true;
+}
+
+string FixpointStore::Key(const CFG &cfg, const CFG * cfg2, const string &config) {
+	string text;
+	llvm::raw_string_ostream ros(text);
+	cfg.print(ros,LangOptions());
+	if (cfg2)
+		cfg2->print(ros,LangOptions());
+	ros << State::ManagerType() << ' ' <<
+			State::partition_point_ << ' ' << State::partition_strategy_ << ' ' <<
+			State::widening_point_ << ' ' << State::widening_strategy_ << ' ' << State::widening_threshold_ << ' ' <<
+			VariablePacks::enabled_ << ' ' << TransferFuncs::array_index_pool_size_ << ' ';
+	// with -summaries, the calls are constrained by the summaries of the callees analyzed so far
+	ros << "summaries " << TransferFuncs::call_summaries_.size() << ' ';
+	for (map<string,bool>::const_iterator iter = TransferFuncs::call_summaries_.begin(), end = TransferFuncs::call_summaries_.end(); iter != end; ++iter)
+		ros << iter->first << '=' << iter->second << ' ';
+	for (map<string,pair<double,double> >::const_iterator iter = TransferFuncs::call_differences_.begin(), end = TransferFuncs::call_differences_.end(); iter != end; ++iter)
+		ros << iter->first << '[' << iter->second.first << ',' << iter->second.second << "] ";
+	ros << config;
+	ros.flush();
+	uint64_t hash = 14695981039346656037ULL; // FNV-1a
+	for (size_t i = 0; i < text.size(); ++i)
+		hash = (hash ^ (unsigned char)text[i]) * 1099511628211ULL;
+	stringstream ss;
+	ss << hex << AnalysisUtils::Mix(hash);
+	return ss.str();
+}
+
+string FixpointStore::Path(const string &key) {
+	return directory_ + "/" + key + ".fix";
+}
+
+void FixpointStore::WriteEnvironment(ostream &os, const environment &env) {
+	vector<var> vars = env.get_vars(); // integer dimensions first
+	os << env.get_ap_environment_t()->intdim << ' ' << env.get_ap_environment_t()->realdim << ' ';
+	for (size_t i = 0; i < vars.size(); ++i)
+		WriteName(os,(string)vars[i]);
+	os << '\n';
+}
+
+environment FixpointStore::ReadEnvironment(istream &is) {
+	size_t intdim = 0, realdim = 0;
+	is >> intdim >> realdim;
+	vector<var> int_vars, real_vars;
+	for (size_t i = 0; i < intdim && is; ++i)
+		int_vars.push_back(var(ReadName(is)));
+	for (size_t i = 0; i < realdim && is; ++i)
+		real_vars.push_back(var(ReadName(is)));
+	return environment(int_vars,real_vars);
+}
+
+/**
+ * An abstract is written as its environment and its linear constraints. Constraints with
+ * non scalar coefficients are dropped, which only over-approximates the abstract.
+ */
+void FixpointStore::WriteAbstract(ostream &os, const Abstract1 &abs) {
+	const abstract1 &abstract = *abs.abstract();
+	manager mgr = abstract.get_manager();
+	environment env = abstract.get_environment();
+	WriteEnvironment(os,env);
+	if (abstract.is_bottom(mgr)) {
+		os << "bottom\n";
+		return;
+	}
+	vector<string> lines;
+	ap_lincons1_array_t constraints = ap_abstract1_to_lincons_array(mgr.get_ap_manager_t(),const_cast<ap_abstract1_t*>(abstract.get_ap_abstract1_t()));
+	ap_lincons0_array_t &array = constraints.lincons0_array;
+	for (size_t i = 0; i < array.size; ++i) {
+		ap_lincons0_t &cons = array.p[i];
+		string cst;
+		if (cons.constyp == AP_CONS_EQMOD || cons.linexpr0->cst.discr != AP_COEFF_SCALAR ||
+				!ScalarString(cons.linexpr0->cst.val.scalar,cst))
+			continue;
+		stringstream terms;
+		size_t count = 0, k;
+		bool scalar = true;
+		ap_dim_t dim;
+		ap_coeff_t * coeff;
+		ap_linexpr0_ForeachLinterm(cons.linexpr0,k,dim,coeff) {
+			if (ap_coeff_zero(coeff))
+				continue;
+			string value;
+			if (coeff->discr != AP_COEFF_SCALAR || !ScalarString(coeff->val.scalar,value)) {
+				scalar = false;
+				break;
+			}
+			WriteName(terms,(string)env.get_var(dim));
+			terms << value << ' ';
+			++count;
+		}
+		if (!scalar)
+			continue;
+		stringstream line;
+		line << cons.constyp << ' ' << cst << ' ' << count << ' ' << terms.str();
+		lines.push_back(line.str());
+	}
+	ap_lincons1_array_clear(&constraints);
+	os << "constraints " << lines.size() << '\n';
+	for (size_t i = 0; i < lines.size(); ++i)
+		os << lines[i] << '\n';
+}
+
+Abstract1 FixpointStore::ReadAbstract(istream &is, manager &mgr) {
+	environment env = ReadEnvironment(is);
+	string kind;
+	size_t count = 0;
+	is >> kind;
+	if (kind == "bottom")
+		return Abstract1(abstract1(mgr,env,bottom()));
+	is >> count;
+	vector<tcons1> constraints;
+	for (size_t i = 0; i < count && is; ++i) {
+		int constyp = AP_CONS_SUPEQ;
+		string cst;
+		size_t terms = 0;
+		is >> constyp >> cst >> terms;
+		texpr1 expr = texpr1::builder(env,mpq_class(cst));
+		for (size_t j = 0; j < terms && is; ++j) {
+			string name = ReadName(is), value;
+			is >> value;
+			expr = expr + texpr1::builder(env,mpq_class(value)) * texpr1(env,var(name));
+		}
+		switch (constyp) {
+		case AP_CONS_EQ: constraints.push_back(tcons1(expr == AnalysisUtils::kZero)); break;
+		case AP_CONS_SUP: constraints.push_back(tcons1(expr > AnalysisUtils::kZero)); break;
+		case AP_CONS_DISEQ: constraints.push_back(tcons1(expr != AnalysisUtils::kZero)); break;
+		default: constraints.push_back(tcons1(expr >= AnalysisUtils::kZero));
+		}
+	}
+	abstract1 abs(mgr,env,top());
+	if (constraints.size())
+		abs.meet(mgr,tcons1_array(constraints.size(),&constraints[0]));
+	return Abstract1(abs);
+}
+
+bool FixpointStore::Load(const string &key, map<IDPair,State> &states) {
+	ifstream file(Path(key).c_str());
+	if (!file.is_open())
+		return false;
+	manager mgr = *State::mgr_ptr_;
+	map<IDPair,State> result;
+	string header;
+	size_t count = 0;
+	file >> header >> count;
+	for (size_t i = 0; i < count && file; ++i) {
+		IDPair ids;
+		size_t size = 0;
+		file >> ids.first >> ids.second >> size;
+		State &state = result[ids];
+		state.env_ = ReadEnvironment(file);
+		for (size_t j = 0; j < size && file; ++j) {
+			Abstract1 vars = ReadAbstract(file,mgr);
+			Abstract1 guards = ReadAbstract(file,mgr);
+			state.abs_set_.insert(Abstract2(vars,guards));
+		}
+	}
+	if (header != "fixpoint" || !file) {
+		cerr << "Ignoring unreadable fixpoint " << Path(key) << ".\n";
+		return false;
+	}
+	states.swap(result);
+	return true;
+}
+
+void FixpointStore::Store(const string &key, const map<IDPair,State> &states) {
+	ofstream file(Path(key).c_str());
+	if (!file.is_open()) {
+		cerr << "Can not store fixpoint at " << Path(key) << ".\n";
+		return;
+	}
+	file << "fixpoint " << states.size() << '\n';
+	for (map<IDPair,State>::const_iterator iter = states.begin(), end = states.end(); iter != end; ++iter) {
+		const State &state = iter->second;
+		file << iter->first.first << ' ' << iter->first.second << ' ' << state.abs_set_.size() << '\n';
+		WriteEnvironment(file,state.env_);
+		for (AbstractSet::const_iterator abs_iter = state.abs_set_.begin(), abs_end = state.abs_set_.end(); abs_iter != abs_end; ++abs_iter) {
+			WriteAbstract(file,abs_iter->vars);
+			WriteAbstract(file,abs_iter->guards);
+		}
+	}
+}
+
+}
@@ -0,0 +1,55 @@
+/*
+ * FixpointStore.h
+ *
+ * Persists the fixpoint computed for a function, so a later run over the same function body
+ * (e.g. the next version pair of a series) starts from it instead of from scratch.
+ * Entries are keyed by a hash of the printed CFG(s) and the analysis configuration, and map
+ * pairs of block IDs (an edge for dizy, a product location for score) to states.
+ * A stored fixpoint is only used as the initial value: the solvers still propagate over it,
+ * so for an unchanged function the iteration stops after one pass.
+ */
+
+#ifndef FIXPOINT_STORE_H
+#define FIXPOINT_STORE_H
+
+#include <istream>
+#include <ostream>
+#include <map>
+#include <string>
+using namespace std;
+
+#include <clang/Analysis/CFG.h>
+using namespace clang;
+
+#include "apronxx/apronxx.hh"
+using namespace apron;
+
+#include "APAbstractDomain.h"
+
+namespace differential {
+
+class FixpointStore {
+	typedef APAbstractDomain_ValueTypes::ValTy State;
+
+	static void WriteEnvironment(ostream &os, const environment &env);
+	static environment ReadEnvironment(istream &is);
+	static void WriteAbstract(ostream &os, const Abstract1 &abs);
+	static Abstract1 ReadAbstract(istream &is, manager &mgr);
+	static string Path(const string &key);
+
+public:
+	typedef pair<unsigned,unsigned> IDPair;
+
+	static string directory_; // empty if warm starting is off
+
+	static bool Enabled() { return !directory_.empty(); }
+	// hash of the printed CFG(s), the domain configuration and the given solver configuration
+	static string Key(const CFG &cfg, const CFG * cfg2, const string &config);
+	// false if nothing (readable) was stored under the key
+	static bool Load(const string &key, map<IDPair,State> &states);
+	static void Store(const string &key, const map<IDPair,State> &states);
+};
+
+}
+
+#endif // FIXPOINT_STORE_H
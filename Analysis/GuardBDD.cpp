@@ -0,0 +1,208 @@
+/*
+ * GuardBDD.cpp
+ */
+
+#include "GuardBDD.h"
+
+#include <algorithm>
+
+namespace differential {
+
+const unsigned GuardBDD::kTerminal = ~0u;
+const size_t GuardBDD::kMaxConstraintVars = 16;
+const BDDNode GuardBDD::kFalseNode = { ~0u, NULL, NULL };
+const BDDNode GuardBDD::kTrueNode = { ~0u, NULL, NULL };
+const GuardBDD::Ref GuardBDD::kFalse = &GuardBDD::kFalseNode;
+const GuardBDD::Ref GuardBDD::kTrue = &GuardBDD::kTrueNode;
+
+map<GuardBDD::NodeKey,const BDDNode*> GuardBDD::unique_table_;
+map<pair<const BDDNode*,const BDDNode*>,const BDDNode*> GuardBDD::and_cache_;
+map<pair<const BDDNode*,const BDDNode*>,const BDDNode*> GuardBDD::or_cache_;
+map<const BDDNode*,const BDDNode*> GuardBDD::not_cache_;
+map<const abstract1*,const BDDNode*> GuardBDD::abstract_cache_;
+map<string,unsigned> GuardBDD::var_order_;
+
+// variables are ordered by first appearance
+unsigned GuardBDD::VarIndex(const string &name) {
+	map<string,unsigned>::const_iterator iter = var_order_.find(name);
+	if (iter != var_order_.end())
+		return iter->second;
+	unsigned index = var_order_.size();
+	return (var_order_[name] = index);
+}
+
+const BDDNode * GuardBDD::MakeNode(unsigned var, const BDDNode * low, const BDDNode * high) {
+	if (low == high)
+		return low;
+	NodeKey key(var,make_pair(low,high));
+	map<NodeKey,const BDDNode*>::const_iterator iter = unique_table_.find(key);
+	if (iter != unique_table_.end())
+		return iter->second;
+	BDDNode * node = new BDDNode;
+	node->var = var;
+	node->low = low;
+	node->high = high;
+	return (unique_table_[key] = node);
+}
+
+GuardBDD::Ref GuardBDD::Var(const string &name) {
+	return MakeNode(VarIndex(name),kFalse,kTrue);
+}
+
+GuardBDD::Ref GuardBDD::Apply(bool conjunction, Ref left, Ref right) {
+	Ref absorbing = conjunction ? kFalse : kTrue, neutral = conjunction ? kTrue : kFalse;
+	if (left == absorbing || right == absorbing)
+		return absorbing;
+	if (left == neutral || left == right)
+		return right;
+	if (right == neutral)
+		return left;
+	if (right < left) // both operations are commutative
+		swap(left,right);
+	map<pair<Ref,Ref>,Ref> &cache = conjunction ? and_cache_ : or_cache_;
+	pair<Ref,Ref> key(left,right);
+	map<pair<Ref,Ref>,Ref>::const_iterator iter = cache.find(key);
+	if (iter != cache.end())
+		return iter->second;
+	unsigned var = min(left->var,right->var);
+	Ref left_low = (left->var == var) ? left->low : left, left_high = (left->var == var) ? left->high : left;
+	Ref right_low = (right->var == var) ? right->low : right, right_high = (right->var == var) ? right->high : right;
+	Ref result = MakeNode(var,Apply(conjunction,left_low,right_low),Apply(conjunction,left_high,right_high));
+	return (cache[key] = result);
+}
+
+GuardBDD::Ref GuardBDD::And(Ref left, Ref right) {
+	return Apply(true,left,right);
+}
+
+GuardBDD::Ref GuardBDD::Or(Ref left, Ref right) {
+	return Apply(false,left,right);
+}
+
+GuardBDD::Ref GuardBDD::Not(Ref bdd) {
+	if (bdd == kFalse)
+		return kTrue;
+	if (bdd == kTrue)
+		return kFalse;
+	map<Ref,Ref>::const_iterator iter = not_cache_.find(bdd);
+	if (iter != not_cache_.end())
+		return iter->second;
+	return (not_cache_[bdd] = MakeNode(bdd->var,Not(bdd->low),Not(bdd->high)));
+}
+
+namespace {
+
+const double kEpsilon = 1e-9;
+
+bool Holds(double value, int constyp) {
+	switch (constyp) {
+	case AP_CONS_EQ: return value < kEpsilon && value > -kEpsilon;
+	case AP_CONS_SUPEQ: return value > -kEpsilon;
+	case AP_CONS_SUP: return value > kEpsilon;
+	case AP_CONS_DISEQ: return !(value < kEpsilon && value > -kEpsilon);
+	default: return true;
+	}
+}
+
+}
+
+/**
+ * The valuations of vars[index..] for which (sum + coeffs.vars constyp 0) holds. vars are sorted by order.
+ * Sub-results are shared by (index,sum), and a suffix whose whole range [low,high] decides the constraint
+ * is a constant, so the size follows the number of distinct partial sums rather than the 2^n valuations.
+ */
+GuardBDD::Ref GuardBDD::FromConstraint(const vector<unsigned> &vars, const vector<double> &coeffs, size_t index, double sum, int constyp,
+		const vector<double> &low, const vector<double> &high, map<pair<size_t,double>,Ref> &memo) {
+	double range_low = sum + low[index], range_high = sum + high[index];
+	bool holds_low = Holds(range_low,constyp), holds_high = Holds(range_high,constyp);
+	bool monotone = (constyp == AP_CONS_SUPEQ || constyp == AP_CONS_SUP);
+	bool outside = (range_high <= -kEpsilon || range_low >= kEpsilon); // the suffix never sums to 0
+	if (index == vars.size() || (monotone && holds_low == holds_high) || (!monotone && outside) || range_low == range_high)
+		return holds_high ? kTrue : kFalse;
+	pair<size_t,double> key(index,sum);
+	map<pair<size_t,double>,Ref>::const_iterator iter = memo.find(key);
+	if (iter != memo.end())
+		return iter->second;
+	return (memo[key] = MakeNode(vars[index],
+			FromConstraint(vars,coeffs,index + 1,sum,constyp,low,high,memo),
+			FromConstraint(vars,coeffs,index + 1,sum + coeffs[index],constyp,low,high,memo)));
+}
+
+/**
+ * Conjunction of the BDDs of the constraints of the abstract. Constraints that can not be handled
+ * are dropped, so the result may over-approximate the abstract, never under-approximate it.
+ */
+GuardBDD::Ref GuardBDD::FromAbstract(const abstract1 &abs) {
+	manager mgr = abs.get_manager();
+	if (abs.is_bottom(mgr))
+		return kFalse;
+	if (abs.is_top(mgr))
+		return kTrue;
+	environment env = abs.get_environment();
+	Ref result = kTrue;
+	ap_lincons1_array_t constraints = ap_abstract1_to_lincons_array(mgr.get_ap_manager_t(),const_cast<ap_abstract1_t*>(abs.get_ap_abstract1_t()));
+	ap_lincons0_array_t &array = constraints.lincons0_array;
+	for (size_t i = 0; i < array.size && result != kFalse; ++i) {
+		ap_lincons0_t &cons = array.p[i];
+		if (cons.constyp == AP_CONS_EQMOD || cons.linexpr0->cst.discr != AP_COEFF_SCALAR)
+			continue;
+		vector<pair<unsigned,double> > terms;
+		bool scalar = true;
+		size_t k;
+		ap_dim_t dim;
+		ap_coeff_t * coeff;
+		ap_linexpr0_ForeachLinterm(cons.linexpr0,k,dim,coeff) {
+			if (ap_coeff_zero(coeff))
+				continue;
+			if (coeff->discr != AP_COEFF_SCALAR) {
+				scalar = false;
+				break;
+			}
+			double c;
+			ap_double_set_scalar(&c,coeff->val.scalar,GMP_RNDN);
+			terms.push_back(make_pair(VarIndex(env.get_var(dim)),c));
+		}
+		if (!scalar || terms.size() > kMaxConstraintVars)
+			continue;
+		sort(terms.begin(),terms.end());
+		vector<unsigned> vars;
+		vector<double> coeffs;
+		for (size_t j = 0; j < terms.size(); ++j) {
+			vars.push_back(terms[j].first);
+			coeffs.push_back(terms[j].second);
+		}
+		// low[j]/high[j] bound what vars[j..] can add to the sum
+		vector<double> low(vars.size() + 1,0), high(vars.size() + 1,0);
+		for (size_t j = vars.size(); j-- > 0;) {
+			low[j] = low[j + 1] + min(coeffs[j],0.0);
+			high[j] = high[j + 1] + max(coeffs[j],0.0);
+		}
+		double cst;
+		ap_double_set_scalar(&cst,cons.linexpr0->cst.val.scalar,GMP_RNDN);
+		map<pair<size_t,double>,Ref> memo;
+		result = And(result,FromConstraint(vars,coeffs,0,cst,cons.constyp,low,high,memo));
+	}
+	ap_lincons1_array_clear(&constraints);
+	return result;
+}
+
+void GuardBDD::Clear() {
+	for (map<NodeKey,const BDDNode*>::const_iterator iter = unique_table_.begin(), end = unique_table_.end(); iter != end; ++iter)
+		delete iter->second;
+	unique_table_.clear();
+	and_cache_.clear();
+	or_cache_.clear();
+	not_cache_.clear();
+	abstract_cache_.clear();
+	var_order_.clear();
+}
+
+GuardBDD::Ref GuardBDD::FromAbstract(const Abstract1 &abs) {
+	const abstract1 * abstract_ptr = abs.abstract();
+	map<const abstract1*,Ref>::const_iterator iter = abstract_cache_.find(abstract_ptr);
+	if (iter != abstract_cache_.end())
+		return iter->second;
+	return (abstract_cache_[abstract_ptr] = FromAbstract(*abstract_ptr));
+}
+
+}
@@ -0,0 +1,76 @@
+/*
+ * GuardBDD.h
+ *
+ * Reduced ordered BDDs over guard variables, with hash-consed nodes. The guards themselves stay
+ * (interned) abstracts; the meets only consult the BDDs of the guards, cached per interned abstract,
+ * to skip pairs of guards with no common valuation before meeting the polyhedra.
+ * Guards are booleans (typedef short Guard holding 0/1), so only {0,1} valuations are represented.
+ * This is stricter than the polyhedra the guards live in: a guards abstract with no 0/1 valuation
+ * is kFalse even when it is not bottom over the rationals (e.g. g+h=1 and g=h).
+ */
+
+#ifndef GUARD_BDD_H
+#define GUARD_BDD_H
+
+#include <map>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "apronxx/apronxx.hh"
+using namespace apron;
+
+#include "Abstract1.h"
+
+namespace differential {
+
+struct BDDNode {
+	unsigned var; // index in the variable order (kTerminal for the constants)
+	const BDDNode * low;  // var == 0
+	const BDDNode * high; // var == 1
+};
+
+class GuardBDD {
+	GuardBDD() {}
+
+	typedef pair<unsigned,pair<const BDDNode*,const BDDNode*> > NodeKey;
+	static map<NodeKey,const BDDNode*> unique_table_;
+	static map<pair<const BDDNode*,const BDDNode*>,const BDDNode*> and_cache_;
+	static map<pair<const BDDNode*,const BDDNode*>,const BDDNode*> or_cache_;
+	static map<const BDDNode*,const BDDNode*> not_cache_;
+	static map<const abstract1*,const BDDNode*> abstract_cache_;
+	static map<string,unsigned> var_order_;
+
+	static const BDDNode * MakeNode(unsigned var, const BDDNode * low, const BDDNode * high);
+	static const BDDNode * Apply(bool conjunction, const BDDNode * left, const BDDNode * right);
+	static const BDDNode * FromConstraint(const vector<unsigned> &vars, const vector<double> &coeffs, size_t index, double sum, int constyp,
+			const vector<double> &low, const vector<double> &high, map<pair<size_t,double>,const BDDNode*> &memo);
+
+public:
+	typedef const BDDNode * Ref;
+
+	static const unsigned kTerminal;
+	static const size_t kMaxConstraintVars; // wider constraints are dropped (over-approximated)
+	static const BDDNode kFalseNode;
+	static const BDDNode kTrueNode;
+	static const Ref kFalse;
+	static const Ref kTrue;
+
+	static unsigned VarIndex(const string &name);
+	static Ref Var(const string &name);
+	static Ref And(Ref left, Ref right);
+	static Ref Or(Ref left, Ref right);
+	static Ref Not(Ref bdd);
+	static bool Implies(Ref left, Ref right) { return And(left,Not(right)) == kFalse; }
+
+	// the boolean valuations of the given (guards) abstract
+	static Ref FromAbstract(const abstract1 &abs);
+	static Ref FromAbstract(const Abstract1 &abs); // cached, interned abstracts are never freed
+
+	// frees all nodes and forgets the variable order, call between functions (invalidates every Ref)
+	static void Clear();
+};
+
+}
+
+#endif // GUARD_BDD_H
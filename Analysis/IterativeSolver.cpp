@@ -6,10 +6,15 @@
  */
 
 #include "IterativeSolver.h"
+#include "VariablePacks.h"
+#include "FixpointStore.h"
+#include "../DTL/dtl.hpp"
 
+#include <algorithm>
 #include <iostream>
 #include <limits>
 #include <pthread.h>
+#include <sys/time.h>
 
 #define DEBUG 0
 #define DEBUG1 0
@@ -18,6 +23,59 @@ namespace differential {
 
 ThreadArguments thread_arguments_[MAX_K + 1];
 
+bool IterativeSolver::liveness_projection_ = false;
+bool IterativeSolver::adaptive_lookahead_ = false;
+unsigned int IterativeSolver::lookahead_cap_ = MAX_K;
+double IterativeSolver::lookahead_time_budget_ = 0;
+bool IterativeSolver::lockstep_ = false;
+static const char * kDefaultObservableCallees[] = { "printf" };
+set<string> IterativeSolver::observable_callees_(kDefaultObservableCallees,kDefaultObservableCallees + 1);
+set< pair<unsigned,unsigned> > IterativeSolver::report_pairs_;
+
+/**
+ * The equivalence score of a state: the fraction of common variables that are equivalent, summed over its abstracts.
+ * Cached by the state alone during RunOnCFGs, so states that did not change are not re-scored across rounds.
+ * A fingerprint match is only a hit if the state holds the very same interned abstracts, which is all the
+ * cache keeps of it (interned abstracts are never freed, so the pointers stay valid).
+ */
+float IterativeSolver::Score(const State &state) {
+	vector< pair<AbstractPointers,float> > * cached = NULL;
+	AbstractPointers abstracts;
+	if (score_cache_) {
+		for (AbstractSet::const_iterator abs_iter = state.abs_set_.begin(), abs_end = state.abs_set_.end(); abs_iter != abs_end; ++abs_iter)
+			abstracts.push_back(make_pair(abs_iter->vars.abstract(),abs_iter->guards.abstract()));
+		cached = &(*score_cache_)[state.Fingerprint()];
+		for (vector< pair<AbstractPointers,float> >::const_iterator iter = cached->begin(), end = cached->end(); iter != end; ++iter)
+			if (iter->first == abstracts)
+				return iter->second;
+	}
+	unsigned int num_non_equiv = 0, num_common_vars = 0, num_equiv = 0;
+	for (AbstractSet::const_iterator abs_iter = state.abs_set_.begin(), abs_end = state.abs_set_.end(); abs_iter != abs_end; ++abs_iter) {
+		num_common_vars += abs_iter->vars.CommonVars().size();
+		num_non_equiv += abs_iter->vars.NonEquivVars().size();
+	}
+	float result = 0;
+	if (num_common_vars) { // only abstracts that have common vars may receive a score
+		num_equiv = num_common_vars - num_non_equiv;
+		result = ((float)num_equiv / num_common_vars);
+	} //otherwise they get 0
+	if (cached)
+		cached->push_back(make_pair(abstracts,result));
+	return result;
+}
+
+float IterativeSolver::ChangedScore() {
+	for (set<CFGBlockPair>::const_iterator iter = unscored_.begin(), end = unscored_.end(); iter != end; ++iter) {
+		float pcs_score = Score(statespace_[*iter]);
+		changed_scores_[*iter] = pcs_score;
+		changed_score_sum_ += pcs_score;
+		changed_scored_++;
+		errs() << "(" << iter->first->getBlockID() << "," << iter->second->getBlockID() << ") = " << pcs_score << ", ";
+	}
+	unscored_.clear();
+	return changed_scored_ ? changed_score_sum_ / changed_scored_ : 0;
+}
+
 void IterativeSolver::AssumeInputEquivalence(const FunctionDecl * fd,const FunctionDecl * fd2) {
 	assert(fd->getNumParams() == fd2->getNumParams());
 	// iterate over input parameters and assume equivalence
@@ -27,6 +85,14 @@ void IterativeSolver::AssumeInputEquivalence(const FunctionDecl * fd,const Funct
 		const Type * type = fd->getParamDecl(i)->getType().getTypePtr();
 		transformer_.AssumeTagEquivalence(transformer_.getVal(),name,type);
 	}
+	// the globals both versions refer to hold the same values on entry, like the parameters
+	map<string,const VarDecl*> globals, globals2;
+	set<const FunctionDecl*> visited, visited2;
+	TransferFuncs::CollectGlobals(fd->getBody(),globals,visited);
+	TransferFuncs::CollectGlobals(fd2->getBody(),globals2,visited2);
+	for (map<string,const VarDecl*>::const_iterator iter = globals.begin(), end = globals.end(); iter != end; ++iter)
+		if (globals2.count(iter->first))
+			transformer_.AssumeTagEquivalence(transformer_.getVal(),iter->first,iter->second->getType().getTypePtr());
 	//AssumeInitialEquivalence(fd->getBody(), fd->getASTContext(), false);
 	//AssumeInitialEquivalence(fd2->getBody(), fd2->getASTContext(), true);
 	transformer_.getNVal() = transformer_.getVal();
@@ -67,8 +133,11 @@ IterativeSolver IterativeSolver::FindMinimalDiffSolver(CFG * cfg_ptr,CFG * cfg2_
 	const unsigned int size = solvers.size();
 	assert(size > 0);
 	errs() << "findMinimalDiffSolver: picking from " << size << " solvers...";
-	if (size == 1)
+	if (size == 1) {
+		solvers[0].score_spread_ = 0;
+		solvers[0].ClearChanged(); // nothing to compare it with
 		return solvers[0];
+	}
 	manager &mgr = *(transformer_.getVal().mgr_ptr_);
 
 	// define the score array and initialize to 0
@@ -78,34 +147,13 @@ IterativeSolver IterativeSolver::FindMinimalDiffSolver(CFG * cfg_ptr,CFG * cfg2_
 	// factor = |CFG x CFG'|
 	unsigned int factor = cfg_ptr->getNumBlockIDs() * cfg2_ptr->getNumBlockIDs();
 
-	// since all solvers start from the same origin, we check only the changed locations
-	//	pthread_t threads[solvers.size()];
+	// since all solvers start from the same origin, we check only the changed locations.
+	// their scores are aggregated as AdvanceOnEdge writes them, only the pairs written last are scored here
 	for (int i = 0 ; i < solvers.size(); ++i) {
 		IterativeSolver &solver = solvers[i];
-		cerr << "\nSolver " << i << ": ";
-		//		thread_arguments_[i].is = solver;
-		//		pthread_create(threads + i, NULL, &differential::IterativeSolver::ComputeEquivalenceScore, &thread_arguments_[i]);
-		int num_scored = 0;
-		for (set<CFGBlockPair>::const_iterator iter = solver.changed_.begin(), end = solver.changed_.end(); iter != end; ++iter) {
-			const AbstractSet &abstracts = solver.statespace_[*iter].abs_set_;
-			if (abstracts.size() == 0)
-				continue;
-			unsigned int num_non_equiv = 0, num_common_vars = 0, num_equiv = 0;
-			for (AbstractSet::const_iterator abs_iter = abstracts.begin(), abs_end = abstracts.end(); abs_iter != abs_end; ++abs_iter) {
-				num_common_vars += abs_iter->vars.CommonVars().size();
-				num_non_equiv += abs_iter->vars.NonEquivVars().size();
-			}
-			if (num_common_vars) { // only abstracts that have common vars may receive a score
-				num_equiv = num_common_vars - num_non_equiv;
-				score[i] += ((float)num_equiv / num_common_vars);
-			} //otherwise they get 0
-			num_scored++;
-			errs() << "(" << iter->first->getBlockID() << "," << iter->second->getBlockID() << ") = " << ((float)num_equiv / num_common_vars) << ", ";
-		}
-		if (num_scored)
-			score[i] /= num_scored;
-		solver.changed_.clear();
-		cerr << "\nOverall normalized score = " << score[i] << "\n";
+		score[i] = solver.ChangedScore();
+		solver.ClearChanged();
+		cerr << "\nSolver " << i << ": Overall normalized score = " << score[i] << "\n";
 	}
 
 	//	for (int i = 0 ; i < solvers.size(); ++i) { // wait for all threads to finish
@@ -205,7 +253,7 @@ IterativeSolver IterativeSolver::FindMinimalDiffSolver(CFG * cfg_ptr,CFG * cfg2_
 
 	// pick the solver with the highest score
 	unsigned int index = 0;
-	float max = score[index];
+	float max = score[index], min = *std::min_element(score,score + size);
 	for (unsigned int i = index + 1; i < size ; ++i) {
 		if (score[i] > max ||
 				(score[i] == max && abs(i - (size/2)) < abs(index - (size/2)))) { // in case of equality, choose the more balanced solution
@@ -222,6 +270,7 @@ IterativeSolver IterativeSolver::FindMinimalDiffSolver(CFG * cfg_ptr,CFG * cfg2_
 #endif
 
 	errs() << "done.\n";
+	solvers[index].score_spread_ = max - min;
 	return solvers[index];
 }
 
@@ -285,7 +334,7 @@ bool IterativeSolver::Step(CFG * cfg_ptr, CFG * other_cfg_ptr, GraphPick which)
 	errs() << "}\n";
 #endif
 	set<CFGBlockPair> step_blocks = workset_;
-	workset_.clear();
+	ClearWorkset();
 	bool can_advance = false;
 	for (set<CFGBlockPair>::const_iterator iter = step_blocks.begin(), end = step_blocks.end(); iter != end ; ++iter) {
 		// if cannot advance on the chosen graph, but can on the other graph
@@ -296,7 +345,7 @@ bool IterativeSolver::Step(CFG * cfg_ptr, CFG * other_cfg_ptr, GraphPick which)
 					iter->second->getBlockID() << ").\n";
 #endif
 			// return it to the work set
-			workset_.insert(*iter);
+			AddToWorkset(*iter);
 			//			AdvanceOnBlock(*other_cfg_ptr,*iter,(GraphPick)(SECOND_GRAPH - which));
 		} else {
 			can_advance = true;
@@ -465,14 +514,14 @@ void IterativeSolver::Partition() {
 #if(DEBUG1)
 			errs() << "Partitioning state at (" << iter->first.first->getBlockID() << "," << iter->first.second->getBlockID() << ")\n";
 #endif
-			if (!backedges_exist) { // no back edges
-				iter->second.Partition();
-				continue;
-			}
 			CFGBlockPair pcs = iter->first;
+			fingerprint_ -= StateHash(pcs,iter->second);
+			iter->second.Partition();
+			fingerprint_ += StateHash(pcs,iter->second);
+			if (!backedges_exist) // no back edges
+				continue;
 			//			if (Backedges(pcs)) { // partition at back-edges only
 			//prev_statespace_[iter->first] = iter->second;
-			iter->second.Partition();
 			//			}
 			// widen if threshold reached and either blocks have back-edges
 			if (visits_[pcs] > transformer_.getVal().widening_threshold_) {
@@ -493,14 +542,145 @@ void IterativeSolver::Partition() {
 	}
 }
 
+// seconds since the epoch, the time budget is wall time (clock() would also count the minimize workers)
+static double WallTime() {
+	struct timeval now;
+	gettimeofday(&now,NULL);
+	return now.tv_sec + now.tv_usec / 1e6;
+}
+
+/**
+ * The lookahead window for the next round: when all speculations scored the same, the interleaving does not
+ * matter here and the window shrinks; when they differ, or a loop head is about to be visited, it grows, past
+ * the initial k_ if needed, up to lookahead_cap_. Once the time budget is spent the window stays at 1.
+ */
+unsigned int IterativeSolver::NextLookahead(unsigned int k, double start) const {
+	if (lookahead_time_budget_ > 0 && WallTime() - start > lookahead_time_budget_)
+		return 1;
+	bool loop_head = false;
+	for (set<CFGBlockPair>::const_iterator iter = workset_.begin(), end = workset_.end(); iter != end && !loop_head; ++iter)
+		loop_head = (backedge_blocks_.first.count(iter->first) || backedge_blocks_.second.count(iter->second));
+	const float epsilon = 1e-6;
+	if (loop_head || score_spread_ > epsilon)
+		return std::min(k + 1,std::max(k_,lookahead_cap_));
+	return std::max(k,2u) - 1;
+}
+
+// the statements of the block, printed without tags, so the same code in both versions has the same signature
+string IterativeSolver::BlockSignature(const CFGBlock * block) {
+	string signature;
+	raw_string_ostream os(signature);
+	for (CFGBlock::const_iterator iter = block->begin(), end = block->end(); iter != end; ++iter) {
+		CFGElement e = *iter;
+		if (const CFGStmt * statement = e.getAs<CFGStmt>()) {
+			statement->getStmt()->printPretty(os,transformer_.getContext(),0,PrintingPolicy(LangOptions()));
+			os << ";";
+		}
+	}
+	if (const Stmt * terminator_statement = block->getTerminator().getStmt())
+		os << terminator_statement->getStmtClassName();
+	return Utils::ReplaceAll(os.str(),Defines::kTagPrefix,"");
+}
+
+/**
+ * Align the blocks of both graphs (from entry to exit) by the shortest edit script of their signatures, the
+ * same way ccc aligns lines when building the union program. Common blocks are matched.
+ */
+void IterativeSolver::MatchBlocks(const CFG &cfg, const CFG &cfg2) {
+	vector<const CFGBlock *> blocks, blocks2;
+	vector<string> signatures, signatures2;
+	for (CFG::const_reverse_iterator iter = cfg.rbegin(), end = cfg.rend(); iter != end; ++iter) {
+		blocks.push_back(*iter);
+		signatures.push_back(BlockSignature(*iter));
+	}
+	for (CFG::const_reverse_iterator iter = cfg2.rbegin(), end = cfg2.rend(); iter != end; ++iter) {
+		blocks2.push_back(*iter);
+		signatures2.push_back(BlockSignature(*iter));
+	}
+	dtl::Diff< string, vector<string> > diff(signatures, signatures2);
+	diff.compose();
+	vector<pair<string, dtl::elemInfo> > seq = diff.getSes().getSequence();
+	unsigned block_num = 0, block2_num = 0;
+	for (size_t i = 0 ; i < seq.size() ; ++i) {
+		switch (seq[i].second.type) {
+		case dtl::SES_ADD:
+			block2_num++;
+			break;
+		case dtl::SES_DELETE:
+			block_num++;
+			break;
+		case dtl::SES_COMMON:
+			matched_blocks_[blocks[block_num++]] = blocks2[block2_num++];
+			break;
+		}
+	}
+	errs() << "Matched " << matched_blocks_.size() << " of (" << blocks.size() << "," << blocks2.size() << ") blocks.\n";
+}
+
+// all pairs in the work set are matched blocks, and both sides can advance
+bool IterativeSolver::CanLockstep(void) {
+	if (!lockstep_ || workset_.empty())
+		return false;
+	for (set<CFGBlockPair>::const_iterator iter = workset_.begin(), end = workset_.end(); iter != end; ++iter) {
+		map< const CFGBlock *, const CFGBlock * >::const_iterator match = matched_blocks_.find(iter->first);
+		if (match == matched_blocks_.end() || match->second != iter->second ||
+				iter->first->succ_empty() || iter->second->succ_empty())
+			return false;
+	}
+	return true;
+}
+
+/**
+ * The interleaving (and so the fixpoint) depends on the lookahead configuration as well,
+ * and the initial state stands for the function signature (which inputs were assumed equal).
+ */
+string IterativeSolver::FixpointKey(const CFG &cfg, const CFG &cfg2, const State &initial_state) const {
+	stringstream config;
+	config << "score " << k_ << ' ' << p_ << ' ' << adaptive_lookahead_ << ' ' << lookahead_cap_ << ' ' << lockstep_ << ' ' <<
+			liveness_projection_ << ' ' << (string)initial_state;
+	return FixpointStore::Key(cfg,&cfg2,config.str());
+}
+
+// seeds the state space with the fixpoint stored for the very same pair of CFGs: joining into it
+// does not grow the states, so pairs are not re-added to the work set once propagated over
+bool IterativeSolver::LoadFixpoint(const CFG &cfg, const CFG &cfg2, const string &key) {
+	map<FixpointStore::IDPair,State> states;
+	if (!FixpointStore::Load(key,states))
+		return false;
+	map<unsigned,const CFGBlock *> blocks, blocks2;
+	for (CFG::const_iterator iter = cfg.begin(), end = cfg.end(); iter != end; ++iter)
+		blocks[(*iter)->getBlockID()] = *iter;
+	for (CFG::const_iterator iter = cfg2.begin(), end = cfg2.end(); iter != end; ++iter)
+		blocks2[(*iter)->getBlockID()] = *iter;
+	for (map<FixpointStore::IDPair,State>::const_iterator iter = states.begin(), end = states.end(); iter != end; ++iter) {
+		if (blocks.count(iter->first.first) && blocks2.count(iter->first.second))
+			SetState(CFGBlockPair(blocks[iter->first.first],blocks2[iter->first.second]),iter->second);
+	}
+	return true;
+}
+
+void IterativeSolver::StoreFixpoint(const string &key) const {
+	map<FixpointStore::IDPair,State> states;
+	for (map< CFGBlockPair , State >::const_iterator iter = statespace_.begin(), end = statespace_.end(); iter != end; ++iter)
+		states[make_pair(iter->first.first->getBlockID(),iter->first.second->getBlockID())] = iter->second;
+	FixpointStore::Store(key,states);
+}
+
 void IterativeSolver::RunOnCFGs(CFG * cfg_ptr,CFG * cfg2_ptr) {
 	CFGBlockPair initial_pcs(*(cfg_ptr->rbegin()),*(cfg2_ptr->rbegin())),
 			exit_pcs(*(cfg_ptr->begin()),*(cfg2_ptr->begin()));
 	// initial state = { V==V' } (this resides in the transformer after assumeInputEquivalence() has been run)
 	State initial_state = transformer_.getVal();
 	int balance = 0;
+	deltas_.clear();
+	ScoreCache score_cache;
+	score_cache_ = &score_cache;
 
-	initial_state.read_map_.clear();
+	State::ClearArrayAccesses();
+
+	// the packs of the first CFG were collected by APAbstractDomain::InitializeValues
+	if (VariablePacks::enabled_)
+		VariablePacks::AddCFG(*cfg2_ptr);
 
 	errs() << "Done parsing CFGs. Press Enter to continue...";
 	getchar();
@@ -511,6 +691,11 @@ void IterativeSolver::RunOnCFGs(CFG * cfg_ptr,CFG * cfg2_ptr) {
 	errs() << "CFGs dumped. Press Enter to continue...";
 	getchar();
 
+	ComputeDeadVars(*cfg_ptr,FIRST_GRAPH);
+	ComputeDeadVars(*cfg2_ptr,SECOND_GRAPH);
+	if (lockstep_)
+		MatchBlocks(*cfg_ptr,*cfg2_ptr);
+
 	FindBackedges(initial_pcs.first,set<const CFGBlock*>(),backedge_blocks_.first );
 	FindBackedges(initial_pcs.second,set<const CFGBlock*>(),backedge_blocks_.second );
 
@@ -528,13 +713,33 @@ void IterativeSolver::RunOnCFGs(CFG * cfg_ptr,CFG * cfg2_ptr) {
 	getchar();
 	cerr << "Starting!\n";
 
+	// warm start (not with a time budget, the interleaving then depends on the timing)
+	string fixpoint_key;
+	if (FixpointStore::Enabled() && lookahead_time_budget_ <= 0) {
+		fixpoint_key = FixpointKey(*cfg_ptr,*cfg2_ptr,initial_state);
+		if (LoadFixpoint(*cfg_ptr,*cfg2_ptr,fixpoint_key))
+			errs() << "Warm start from fixpoint " << fixpoint_key << ".\n";
+	}
+
 	// worklist = { (entry1,entry2) }, statespace = { (entry1,entry2)->{ V==V' } }
-	workset_.insert(initial_pcs);
-	statespace_[initial_pcs] = initial_state;
+	AddToWorkset(initial_pcs);
+	SetState(initial_pcs,initial_state);
+	unsigned int k = k_;
+	double start = WallTime();
 	while (!workset_.empty()) {
+		if (CanLockstep()) { // common code, the interleaving is known
+			errs() << "Lockstep...";
+			Speculate(cfg_ptr,cfg2_ptr,1,1);
+			ClearChanged();
+			steps_++;
+			if (p_ && (steps_ % p_ == 0))
+				Partition();
+			errs() << "done.\n";
+			continue;
+		}
 		vector<IterativeSolver> results;
-		errs() << "Speculating over k = " << k_ << "...";
-		for (int i = 0, j = k_; i <= k_; ++i, --j) {
+		errs() << "Speculating over k = " << k << (adaptive_lookahead_ ? " (adaptive)" : "") << "...";
+		for (int i = 0, j = k; i <= k; ++i, --j) {
 			IterativeSolver is = *this; // we want to speculate from the same point each iteration
 			if (is.Speculate(cfg_ptr,cfg2_ptr,j,i))
 				results.push_back(is);
@@ -549,31 +754,279 @@ void IterativeSolver::RunOnCFGs(CFG * cfg_ptr,CFG * cfg2_ptr) {
 #endif
 		// pick the best result and proceed from it
 		*this = FindMinimalDiffSolver(cfg_ptr,cfg2_ptr,results);
+		if (adaptive_lookahead_)
+			k = NextLookahead(k,start);
 		steps_++;
 		if (p_ && (steps_ % p_ == 0))
 			Partition();
 		errs() << "done.\n";
 	}
-	// print the result at exit point
+	score_cache_ = NULL;
+	if (fixpoint_key.size())
+		StoreFixpoint(fixpoint_key);
 	outs() << "Result:\n" << *this << '\n';
-	State delta_minus,delta_plus;
-	string exit_delta = statespace_[exit_pcs].ComputeDiff(true,false,false,delta_minus,delta_plus);
+	// deltas are only computed at the chosen pairs
+	if (report_pairs_.size()) {
+		map<unsigned,const CFGBlock *> blocks, blocks2;
+		for (CFG::const_iterator iter = cfg_ptr->begin(), end = cfg_ptr->end(); iter != end; ++iter)
+			blocks[(*iter)->getBlockID()] = *iter;
+		for (CFG::const_iterator iter = cfg2_ptr->begin(), end = cfg2_ptr->end(); iter != end; ++iter)
+			blocks2[(*iter)->getBlockID()] = *iter;
+		for (set< pair<unsigned,unsigned> >::const_iterator iter = report_pairs_.begin(), end = report_pairs_.end(); iter != end; ++iter)
+			if (blocks.count(iter->first) && blocks2.count(iter->second))
+				ReportAt(CFGBlockPair(blocks[iter->first],blocks2[iter->second]),"");
+		return;
+	}
+	// print the result at exit point
+	string exit_delta = DeltaAt(exit_pcs);
 	outs() << "Delta at (EXIT,EXIT):\n" << (exit_delta.size() ? exit_delta : "Empty.") << '\n';
 
-	for (CFG::const_iterator iter = cfg_ptr->begin(), end = cfg_ptr->end(); iter != end; ++iter) {
-		for (CFG::const_iterator iter2 = cfg2_ptr->begin(), end2 = cfg2_ptr->end(); iter2 != end2; ++iter2) {
-			CFGBlockPair printf_pcs(*iter,*iter2);
-			string s,s2;
-			raw_string_ostream ros(s),ros2(s2);
-			printf_pcs.first->print(ros,cfg_ptr,LangOptions());
-			printf_pcs.second->print(ros2,cfg2_ptr,LangOptions());
-			if (ros.str().find("printf") != ros.str().npos && ros2.str().find("printf") != ros2.str().npos) {
-				outs() << "State at (" << printf_pcs.first->getBlockID() << "," << printf_pcs.second->getBlockID() << ") : " << statespace_[printf_pcs];
-				string delta = statespace_[printf_pcs].ComputeDiff(true,false,false,delta_minus,delta_plus);
-				outs() << "Delta at (" << printf_pcs.first->getBlockID() << "," << printf_pcs.second->getBlockID() << ") (blocks contain printf): "<< (delta.size() ? delta : "Empty.") << '\n';
+	// report the pairs of observable blocks that were reached
+	set<const CFGBlock *> observable, observable2;
+	ObservableBlocks(*cfg_ptr,observable);
+	ObservableBlocks(*cfg2_ptr,observable2);
+	for (set<const CFGBlock *>::const_iterator iter = observable.begin(), end = observable.end(); iter != end; ++iter)
+		for (set<const CFGBlock *>::const_iterator iter2 = observable2.begin(), end2 = observable2.end(); iter2 != end2; ++iter2)
+			ReportAt(CFGBlockPair(*iter,*iter2)," (blocks call an observable function)");
+}
+
+string IterativeSolver::DeltaAt(const CFGBlockPair &pcs) {
+	map< CFGBlockPair , string >::const_iterator iter = deltas_.find(pcs);
+	if (iter != deltas_.end())
+		return iter->second;
+	string delta;
+	map< CFGBlockPair , State >::const_iterator state_iter = statespace_.find(pcs);
+	if (state_iter != statespace_.end()) {
+		State state = state_iter->second, delta_minus, delta_plus;
+		delta = state.ComputeDiff(true,false,false,delta_minus,delta_plus);
+	}
+	return (deltas_[pcs] = delta);
+}
+
+// prints the state and delta at the pair, if it was reached
+void IterativeSolver::ReportAt(const CFGBlockPair &pcs, const string &note) {
+	map< CFGBlockPair , State >::const_iterator state_iter = statespace_.find(pcs);
+	if (state_iter == statespace_.end())
+		return;
+	string delta = DeltaAt(pcs);
+	outs() << "State at (" << pcs.first->getBlockID() << "," << pcs.second->getBlockID() << ") : " << state_iter->second;
+	outs() << "Delta at (" << pcs.first->getBlockID() << "," << pcs.second->getBlockID() << ")" << note << ": "<< (delta.size() ? delta : "Empty.") << '\n';
+}
+
+// blocks with a call to one of observable_callees_ (e.g. where the output of the versions is compared)
+void IterativeSolver::ObservableBlocks(const CFG &cfg, set<const CFGBlock *> &result) {
+	for (CFG::const_iterator block_iter = cfg.begin(), block_end = cfg.end(); block_iter != block_end; ++block_iter) {
+		bool observable = false;
+		for (CFGBlock::const_iterator iter = (*block_iter)->begin(), end = (*block_iter)->end(); iter != end && !observable; ++iter) {
+			CFGElement e = *iter;
+			if (const CFGStmt * statement = e.getAs<CFGStmt>())
+				observable = CallsObservable(statement->getStmt());
+		}
+		if (observable)
+			result.insert(*block_iter);
+	}
+}
+
+bool IterativeSolver::CallsObservable(const Stmt * stmt) {
+	if (!stmt)
+		return false;
+	if (const CallExpr * call = dyn_cast<CallExpr>(stmt))
+		if (const FunctionDecl * callee = call->getDirectCallee())
+			if (observable_callees_.count(callee->getNameAsString()))
+				return true;
+	for (Stmt::const_child_iterator iter = stmt->child_begin(), end = stmt->child_end(); iter != end; ++iter)
+		if (CallsObservable(*iter))
+			return true;
+	return false;
+}
+
+/**
+ * The variables a caller can observe after the call are the return value, the globals and whatever
+ * is written through a pointer (pointer or array parameters, and pointer locals that may alias them),
+ * so only a difference in the non-pointer locals, the call results or the array reads does not count.
+ */
+bool IterativeSolver::ExitEquivalent(const CFG &cfg, const CFG &cfg2) {
+	CFGBlockPair exit_pcs(*(cfg.begin()),*(cfg2.begin()));
+	set<const VarDecl *> decls;
+	const CFG * cfgs[] = { &cfg, &cfg2 };
+	for (unsigned i = 0; i < 2; ++i) {
+		for (CFG::const_iterator block_iter = cfgs[i]->begin(), block_end = cfgs[i]->end(); block_iter != block_end; ++block_iter) {
+			for (CFGBlock::const_iterator iter = (*block_iter)->begin(), end = (*block_iter)->end(); iter != end; ++iter) {
+				CFGElement e = *iter;
+				if (const CFGStmt * statement = e.getAs<CFGStmt>())
+					CollectLocalDecls(statement->getStmt(),decls);
+			}
+		}
+	}
+	set<string> locals;
+	for (set<const VarDecl *>::const_iterator iter = decls.begin(), end = decls.end(); iter != end; ++iter)
+		if ((*iter)->getNameAsString() != Defines::kRetVal && !(*iter)->getType()->isPointerType() && !(*iter)->getType()->isArrayType())
+			locals.insert((*iter)->getNameAsString());
+	manager mgr = *State::mgr_ptr_;
+	const AbstractSet &abstracts = statespace_[exit_pcs].abs_set_;
+	for (AbstractSet::const_iterator abs_iter = abstracts.begin(), abs_end = abstracts.end(); abs_iter != abs_end; ++abs_iter) {
+		if (abs_iter->vars.abstract()->is_bottom(mgr))
+			continue;
+		// a non-local (a global, or the return value) only one version has, e.g. a global only one version writes
+		vector<var> vars = abs_iter->vars.abstract()->get_environment().get_vars();
+		environment env = abs_iter->vars.abstract()->get_environment();
+		for (size_t i = 0; i < vars.size(); ++i) {
+			string name = vars[i], name_tag;
+			Utils::Names(name,name_tag);
+			if (env.contains(name) && env.contains(name_tag))
+				continue;
+			if (name.find(Defines::kArrayUpdatePrefix + "(") == 0)
+				return false; // a write through a pointer
+			if (locals.count(name) || name.find('(') != name.npos || AnalysisUtils::IsArrayInstrumentationVar(var(name)))
+				continue;
+			return false;
+		}
+		const set<var> &non_equiv = abs_iter->vars.NonEquivVars();
+		for (set<var>::const_iterator iter = non_equiv.begin(), end = non_equiv.end(); iter != end; ++iter) {
+			string name = *iter, name_tag;
+			Utils::Names(name,name_tag);
+			if (name.find(Defines::kArrayUpdatePrefix + "(") == 0)
+				return false; // a write through a pointer
+			if (locals.count(name) || name.find('(') != name.npos || AnalysisUtils::IsArrayInstrumentationVar(var(name)))
+				continue; // non-pointer locals, call results and array reads
+			return false;
+		}
+	}
+	return true;
+}
+
+/**
+ * Bounds the difference of the return values over all the abstracts of the exit, rounded outwards.
+ * False when the difference is unbounded, no path returns, or only one version returns a value.
+ */
+bool IterativeSolver::ReturnDifference(const CFG &cfg, const CFG &cfg2, double &low, double &high) {
+	CFGBlockPair exit_pcs(*(cfg.begin()),*(cfg2.begin()));
+	string name = Defines::kRetVal, name_tag;
+	Utils::Names(name,name_tag);
+	var ret(name), ret_tag(name_tag);
+	manager mgr = *State::mgr_ptr_;
+	const AbstractSet &abstracts = statespace_[exit_pcs].abs_set_;
+	bool found = false;
+	for (AbstractSet::const_iterator abs_iter = abstracts.begin(), abs_end = abstracts.end(); abs_iter != abs_end; ++abs_iter) {
+		const abstract1 &abs = *abs_iter->vars.abstract();
+		if (abs.is_bottom(mgr))
+			continue;
+		environment env = abs.get_environment();
+		if (!env.contains(ret) || !env.contains(ret_tag))
+			return false;
+		texpr1 diff = texpr1(env,ret_tag) - texpr1(env,ret);
+		ap_interval_t * bounds = ap_abstract1_bound_texpr(mgr.get_ap_manager_t(),const_cast<ap_abstract1_t*>(abs.get_ap_abstract1_t()),
+				const_cast<ap_texpr1_t*>(diff.get_ap_texpr1_t()));
+		bool bounded = !ap_scalar_infty(bounds->inf) && !ap_scalar_infty(bounds->sup);
+		double inf, sup;
+		if (bounded) {
+			ap_double_set_scalar(&inf,bounds->inf,GMP_RNDD);
+			ap_double_set_scalar(&sup,bounds->sup,GMP_RNDU);
+		}
+		ap_interval_free(bounds);
+		if (!bounded)
+			return false;
+		low = found ? min(low,inf) : inf;
+		high = found ? max(high,sup) : sup;
+		found = true;
+	}
+	return found;
+}
+
+void IterativeSolver::CollectLocalDecls(const Stmt * stmt, set<const VarDecl *> &decls) {
+	vector<const VarDecl *> all_decls;
+	Utils::CollectVarDecls(stmt,all_decls);
+	for (vector<const VarDecl *>::const_iterator iter = all_decls.begin(), end = all_decls.end(); iter != end; ++iter)
+		if ((*iter)->hasLocalStorage())
+			decls.insert(*iter);
+}
+
+/**
+ * For each block, the local variables of the graph that are not live at its exit.
+ * The state is projected by name, so a name is dead only if every variable by that name is
+ * a dead local (shadowed locals, or a local shadowing a global, share the name).
+ * The return value is observable at the exit point, so it is always kept.
+ */
+void IterativeSolver::ComputeDeadVars(const CFG &cfg, GraphPick which) {
+	LiveVariables * liveness = liveness_[which];
+	if (!liveness)
+		return;
+	map<string,set<const VarDecl *> > decls; // name -> every variable by that name
+	for (CFG::const_iterator block_iter = cfg.begin(), block_end = cfg.end(); block_iter != block_end; ++block_iter) {
+		const CFGBlock * block = *block_iter;
+		for (CFGBlock::const_iterator iter = block->begin(), end = block->end(); iter != end; ++iter) {
+			CFGElement e = *iter;
+			if (const CFGStmt * statement = e.getAs<CFGStmt>()) {
+				vector<const VarDecl *> statement_decls;
+				Utils::CollectVarDecls(statement->getStmt(),statement_decls);
+				for (vector<const VarDecl *>::const_iterator decl = statement_decls.begin(), decls_end = statement_decls.end(); decl != decls_end; ++decl)
+					decls[(*decl)->getNameAsString()].insert(*decl);
+			}
+		}
+	}
+	for (CFG::const_iterator block_iter = cfg.begin(), block_end = cfg.end(); block_iter != block_end; ++block_iter) {
+		const CFGBlock * block = *block_iter;
+		vector<var> &dead = dead_vars_[block];
+		for (map<string,set<const VarDecl *> >::const_iterator iter = decls.begin(), end = decls.end(); iter != end; ++iter) {
+			if (iter->first == Defines::kRetVal)
+				continue;
+			bool all_dead = true;
+			for (set<const VarDecl *>::const_iterator decl = iter->second.begin(), decls_end = iter->second.end(); all_dead && decl != decls_end; ++decl)
+				all_dead = (*decl)->hasLocalStorage() && !liveness->isLive(block,*decl);
+			if (all_dead)
+				dead.push_back(var((which == SECOND_GRAPH ? Defines::kTagPrefix : "") + iter->first));
+		}
+	}
+}
+
+/**
+ * Removes the variables that are dead at the exit of the given block from the state(s) about to be
+ * propagated to its successors. Array instrumentation variables go along with their (dead) array.
+ */
+void IterativeSolver::ProjectDeadVars(const CFGBlock * block) {
+	map< const CFGBlock *, vector<var> >::const_iterator dead_iter = dead_vars_.find(block);
+	if (dead_iter == dead_vars_.end() || dead_iter->second.empty())
+		return;
+	vector<var> dead = dead_iter->second;
+	set<var> dead_set(dead.begin(),dead.end());
+	const map< var,vector<var> > * instrumentation[] = { &State::read_map_, &State::update_map_ };
+	for (unsigned i = 0; i < 2; ++i) {
+		for (map< var,vector<var> >::const_iterator iter = instrumentation[i]->begin(), end = instrumentation[i]->end(); iter != end; ++iter) {
+			if (dead_set.count(iter->second[0])) { // (A,idx_l)
+				dead.push_back(iter->first);
+				dead.push_back(iter->second[1]);
 			}
 		}
 	}
+	transformer_.getVal().Project(dead);
+	transformer_.getNVal().Project(dead);
+}
+
+uint64_t IterativeSolver::StateHash(const CFGBlockPair &pcs, const State &state) {
+	if (state.size() == 0)
+		return 0;
+	return AnalysisUtils::Mix(((uint64_t)pcs.first->getBlockID() << 32 | pcs.second->getBlockID()) ^ state.Fingerprint());
+}
+
+uint64_t IterativeSolver::WorksetHash(const CFGBlockPair &pcs) {
+	return AnalysisUtils::Mix(AnalysisUtils::Mix((uint64_t)pcs.first->getBlockID() << 32 | pcs.second->getBlockID()));
+}
+
+void IterativeSolver::SetState(const CFGBlockPair &pcs, const State &state) {
+	State &current = statespace_[pcs];
+	fingerprint_ += StateHash(pcs,state) - StateHash(pcs,current);
+	current = state;
+}
+
+void IterativeSolver::AddToWorkset(const CFGBlockPair &pcs) {
+	if (workset_.insert(pcs).second)
+		fingerprint_ += WorksetHash(pcs);
+}
+
+void IterativeSolver::ClearWorkset() {
+	for (set< CFGBlockPair >::const_iterator iter = workset_.begin(), end = workset_.end(); iter != end; ++iter)
+		fingerprint_ -= WorksetHash(*iter);
+	workset_.clear();
 }
 
 bool IterativeSolver::Backedges(const CFGBlockPair& pcs) {
@@ -646,6 +1099,8 @@ void IterativeSolver::AdvanceOnBlock(const CFG &cfg, const CFGBlockPair pcs, Gra
 #endif
 		}
 	}
+	transformer_.Flush();
+	transformer_.ResetScratch();
 
 	// visit terminator
 	if (const Stmt * terminator_statement = advance_block->getTerminator().getStmt()) {
@@ -670,6 +1125,8 @@ void IterativeSolver::AdvanceOnBlock(const CFG &cfg, const CFGBlockPair pcs, Gra
 		case Stmt::ForStmtClass:
 		{
 			transformer_.BlockStmt_Visit(const_cast<Stmt*>(terminator_statement));
+			transformer_.ResetScratch();
+			ProjectDeadVars(advance_block);
 			const CFGBlock *last_succ = (advance_block->succ_size() > 1) ? *(advance_block->succ_begin() + 1) : NULL;
 			if (last_succ) {
 				CFGBlockPair new_pcs = (which == FIRST_GRAPH) ?
@@ -685,6 +1142,7 @@ void IterativeSolver::AdvanceOnBlock(const CFG &cfg, const CFGBlockPair pcs, Gra
 		case Stmt::BreakStmtClass:
 			break;
 		default: { // short-circuit evaluation
+			ProjectDeadVars(advance_block);
 			// transfer state directly to the actual terminator and return
 			if (BinaryOperator * cond = dyn_cast<BinaryOperator>(const_cast<Stmt*>(terminator_statement))) {
 				assert(advance_block->succ_size() > 1);
@@ -720,6 +1178,11 @@ void IterativeSolver::AdvanceOnBlock(const CFG &cfg, const CFGBlockPair pcs, Gra
 		}
 	}
 
+	// the if/for case has projected already, after visiting the terminator's condition
+	const Stmt * terminator_statement = advance_block->getTerminator().getStmt();
+	if (!terminator_statement || (!isa<IfStmt>(terminator_statement) && !isa<ForStmt>(terminator_statement)))
+		ProjectDeadVars(advance_block);
+
 	const CFGBlock *first_succ = (advance_block->succ_size() > 0) ? *(advance_block->succ_begin()) : NULL;
 	if (first_succ) {
 		CFGBlockPair new_pcs = (which == FIRST_GRAPH) ?
@@ -749,10 +1212,22 @@ void IterativeSolver::AdvanceOnEdge(const CFGBlockPair &new_pcs, bool conditiona
 	errs() << "Advanced on edge, meeting with " << final_state << "\n";
 #endif
 
-	statespace_[new_pcs] = statespace_[new_pcs].Join(final_state);
+	SetState(new_pcs,statespace_[new_pcs].Join(final_state));
 	State state = statespace_[new_pcs], prev_state = prev_statespace_[new_pcs];
 	changed_.insert(new_pcs);
 
+	// the previous score of the pair no longer holds, take it out of the running sum (pairs with no abstracts are not scored)
+	map<CFGBlockPair,float>::iterator score_iter = changed_scores_.find(new_pcs);
+	if (score_iter != changed_scores_.end()) {
+		changed_score_sum_ -= score_iter->second;
+		changed_scored_--;
+		changed_scores_.erase(score_iter);
+	}
+	if (state.abs_set_.size())
+		unscored_.insert(new_pcs);
+	else
+		unscored_.erase(new_pcs);
+
 	// see if the resulting state of new_pcs > previous state or this is the first visit
 	if ((prev_statespace_[new_pcs].size() == 0 &&  statespace_[new_pcs].size() > 0) ||
 			!(state <= prev_state)) {
@@ -769,7 +1244,7 @@ void IterativeSolver::AdvanceOnEdge(const CFGBlockPair &new_pcs, bool conditiona
 #endif
 		//		cerr << "Added (" << new_pcs.first->getBlockID() << ',' << new_pcs.second->getBlockID() << ") : " << statespace_[new_pcs]  << " to workset.\n";
 		//		getchar();
-		workset_.insert(new_pcs); // if so, add it to the work set
+		AddToWorkset(new_pcs); // if so, add it to the work set
 	}
 }
 
@@ -782,9 +1257,9 @@ void IterativeSolver::Widen(const CFGBlockPair pcs) {
 	State result;
 	statespace_[pcs].Widening(prev_statespace_[pcs],statespace_[pcs],result);
 	prev_statespace_[pcs] = statespace_[pcs];
-	statespace_[pcs] = result;
+	SetState(pcs,result);
 	if (!(statespace_[pcs] <= prev_statespace_[pcs]))
-		workset_.insert(pcs);
+		AddToWorkset(pcs);
 #if(DEBUGWiden)
 	errs() << " to " << result;
 	getchar();
@@ -14,6 +14,7 @@
 #include "TransferFuncs.h"
 
 #include <clang/Analysis/CFG.h>
+#include <clang/Analysis/Analyses/LiveVariables.h>
 using namespace clang;
 
 #include <list>
@@ -27,15 +28,22 @@ class IterativeSolver {
 
 public:
 
-	IterativeSolver() {} // deault c'tor defined for threading
+	IterativeSolver() : changed_score_sum_(0), changed_scored_(0), fingerprint_(0), score_spread_(0), score_cache_(NULL) { liveness_[FIRST_GRAPH] = liveness_[SECOND_GRAPH] = NULL; } // deault c'tor defined for threading
 
-	IterativeSolver(APAbstractDomain domain, unsigned int k, unsigned int p) : transformer_(domain.getAnalysisData()), k_(k), p_(p), steps_(0) { assert(k <= MAX_K); }
+	IterativeSolver(APAbstractDomain domain, unsigned int k, unsigned int p) : transformer_(domain.getAnalysisData()), k_(k), p_(p), steps_(0), changed_score_sum_(0), changed_scored_(0), fingerprint_(0), score_spread_(0), score_cache_(NULL) {
+		assert(k <= MAX_K);
+		liveness_[FIRST_GRAPH] = liveness_[SECOND_GRAPH] = NULL;
+	}
 	virtual ~IterativeSolver() { }
 
 	void AssumeInputEquivalence(const FunctionDecl * fd,const FunctionDecl * fd2);
 	void AssumeInitialEquivalence(Stmt* root, ASTContext &context, bool tag); // search CFG for declarations and UFs and assume equivalence for them
+	void SetLiveness(LiveVariables * liveness, LiveVariables * liveness2) { liveness_[FIRST_GRAPH] = liveness; liveness_[SECOND_GRAPH] = liveness2; }
 
 	void RunOnCFGs(CFG * cfg_ptr,CFG * cfg2_ptr);
+	string DeltaAt(const CFGBlockPair &pcs); // after RunOnCFGs: the delta at the pair, computed on the first query ("" if unreached)
+	bool ExitEquivalent(const CFG &cfg, const CFG &cfg2); // after RunOnCFGs: no difference observable by a caller
+	bool ReturnDifference(const CFG &cfg, const CFG &cfg2, double &low, double &high); // after RunOnCFGs: bounds on (ret' - ret)
 
 	typedef APAbstractDomain_ValueTypes::ValTy State;
 	typedef pair<const CFGBlock *,const CFGBlock *> CFGBlockPair;
@@ -43,7 +51,23 @@ public:
 
 	set< CFGBlockPair > workset_;
 	set< CFGBlockPair > changed_;
+	// the score of each changed pair that holds abstracts, kept up to date by AdvanceOnEdge: a pair written again
+	// leaves the running sum and waits in unscored_ until ChangedScore scores it (only for compared candidates)
+	map< CFGBlockPair , float > changed_scores_;
+	set< CFGBlockPair > unscored_;
+	float changed_score_sum_;
+	unsigned int changed_scored_;
+	void ClearChanged() { changed_.clear(); changed_scores_.clear(); unscored_.clear(); changed_score_sum_ = 0; changed_scored_ = 0; }
+	float ChangedScore(); // the average score of the changed pairs
 	map< CFGBlockPair , State > statespace_, prev_statespace_;
+	// the fingerprint is a sum of one hash per work set pair and per non-empty state, so the writes below
+	// keep it up to date (pairs with an empty state, e.g. created by a read, add nothing)
+	uint64_t fingerprint_;
+	void SetState(const CFGBlockPair &pcs, const State &state);
+	void AddToWorkset(const CFGBlockPair &pcs);
+	void ClearWorkset();
+	static uint64_t StateHash(const CFGBlockPair &pcs, const State &state);
+	static uint64_t WorksetHash(const CFGBlockPair &pcs);
 	map< CFGBlockPair , unsigned int > visits_;
 
 	enum { NOT_COMPUTED = -1, EQUIVALENCE = 0 };
@@ -54,6 +78,19 @@ public:
 	typedef enum { FIRST_GRAPH, SECOND_GRAPH } GraphPick ;
 	unsigned int k_, p_, steps_;
 
+	static bool liveness_projection_;
+	static bool adaptive_lookahead_; // adapt the window in [1,lookahead_cap_] to the spread of the scores
+	static unsigned int lookahead_cap_; // the adaptive window may grow up to this (at most MAX_K)
+	static double lookahead_time_budget_; // wall clock seconds per function (0 for none)
+	float score_spread_; // max - min score among the candidates this solver was picked from
+	static bool lockstep_; // advance both graphs together over blocks matched by the syntactic diff
+	static set<string> observable_callees_; // the delta is reported at pairs of blocks calling these (default: printf)
+	static set< pair<unsigned,unsigned> > report_pairs_; // block ID pairs to report (empty for the exit and the observable pairs)
+	map< CFGBlockPair , string > deltas_; // the deltas queried so far
+	map< const CFGBlock *, const CFGBlock * > matched_blocks_; // 1st graph block -> its common counterpart in the 2nd
+	LiveVariables * liveness_[2]; // per graph, NULL if liveness projection is off
+	map< const CFGBlock *, vector<var> > dead_vars_; // variables dead at the exit of each block (tagged for the 2nd graph)
+
 	void AdvanceOnBlock(const CFG &cfg, const CFGBlockPair pcs, GraphPick which);
 	void AdvanceOnEdge(const CFGBlockPair &new_pcs, bool conditional, bool true_branch);
 	void Widen(const CFGBlockPair pcs);
@@ -77,16 +114,38 @@ public:
 		return ss.str();
 	}
 	friend ostream& operator<<(ostream& os, const IterativeSolver& V);
-	bool operator==(const IterativeSolver& rhs) const { return (string)*this == (string)rhs; }
+	uint64_t Fingerprint() const { return fingerprint_; } // hash of the work set and the state space
+	// different fingerprints mean different solvers, the (printed) deep comparison only runs when they match
+	bool operator==(const IterativeSolver& rhs) const { return fingerprint_ == rhs.fingerprint_ && (string)*this == (string)rhs; }
 	bool operator!=(const IterativeSolver& rhs) const { return !(*this == rhs); }
 	bool operator<=(const IterativeSolver& rhs) const { return (string)*this <= (string)rhs; }
 	bool operator<(const IterativeSolver& rhs) const { return (*this != rhs) && (*this <= rhs); }
 
 private:
+	void ComputeDeadVars(const CFG &cfg, GraphPick which);
+	void ProjectDeadVars(const CFGBlock * block);
+	static void CollectLocalDecls(const Stmt * stmt, set<const VarDecl *> &decls);
+	static void ObservableBlocks(const CFG &cfg, set<const CFGBlock *> &result);
+	static bool CallsObservable(const Stmt * stmt);
+	void ReportAt(const CFGBlockPair &pcs, const string &note);
 	void FindBackedges(const CFGBlock* initial, set<const CFGBlock*> visited, set<const CFGBlock*> &result);
 	bool CanPOR(void);
 	bool Backedges(const CFGBlockPair& pcs);
 	void Partition();
+	unsigned int NextLookahead(unsigned int k, double start) const;
+	string BlockSignature(const CFGBlock * block);
+	void MatchBlocks(const CFG &cfg, const CFG &cfg2);
+	bool CanLockstep(void);
+	string FixpointKey(const CFG &cfg, const CFG &cfg2, const State &initial_state) const;
+	bool LoadFixpoint(const CFG &cfg, const CFG &cfg2, const string &key);
+	void StoreFixpoint(const string &key) const;
+
+	// the scores of the states seen by one RunOnCFGs (fingerprint -> the interned (vars,guards) of the states and
+	// their scores), shared by its speculated copies
+	typedef vector< pair<const abstract1*,const abstract1*> > AbstractPointers;
+	typedef map< uint64_t,vector< pair<AbstractPointers,float> > > ScoreCache;
+	ScoreCache * score_cache_; // NULL outside RunOnCFGs
+	float Score(const State &state);
 
 	// experimental!
 	static void * SpeculateParallel(void * arguments);
@@ -26,6 +26,191 @@ ostream& operator<<(ostream& os, const ExpressionState &es){
 	return os;
 }
 
+unsigned TransferFuncs::array_index_pool_size_ = 0;
+map< string,map<unsigned,unsigned> > TransferFuncs::array_index_slots_;
+map<string,bool> TransferFuncs::call_summaries_;
+map<string,pair<double,double> > TransferFuncs::call_differences_;
+map<TransferFuncs::LoweredKey,ExpressionState> TransferFuncs::lowered_;
+map<const Expr*,bool> TransferFuncs::pure_;
+map<const FunctionDecl*,set<string> > TransferFuncs::callee_globals_;
+set<const Expr*> TransferFuncs::warned_;
+
+bool TransferFuncs::IsGuard(Expr * node) {
+	VarDecl * decl = FindBlockVarDecl(node);
+	return decl && decl->getType().getAsString() == Defines::kGuardType;
+}
+
+/**
+ * Whether visiting the expression only computes its ExpressionState, without reading or changing
+ * state_/nstate_: no assignments, calls, array accesses or guard conditions (those swap the states).
+ */
+bool TransferFuncs::IsPure(Expr * node) {
+	map<const Expr*,bool>::const_iterator iter = pure_.find(node);
+	if (iter != pure_.end())
+		return iter->second;
+	bool result = false;
+	if (isa<DeclRefExpr>(node) || isa<IntegerLiteral>(node) || isa<FloatingLiteral>(node) || isa<CharacterLiteral>(node)) {
+		result = true;
+	} else if (ParenExpr * paren = dyn_cast<ParenExpr>(node)) {
+		result = IsPure(paren->getSubExpr());
+	} else if (ImplicitCastExpr * cast_expr = dyn_cast<ImplicitCastExpr>(node)) {
+		result = IsPure(cast_expr->getSubExpr()) && !(cast_expr->getCastKind() == CK_IntegralToBoolean && IsGuard(cast_expr));
+	} else if (UnaryOperator * unary = dyn_cast<UnaryOperator>(node)) {
+		result = IsPure(unary->getSubExpr()) && (unary->getOpcode() == UO_Minus ||
+				(unary->getOpcode() == UO_LNot && !IsGuard(unary->getSubExpr())));
+	} else if (BinaryOperator * binary = dyn_cast<BinaryOperator>(node)) {
+		result = !binary->isAssignmentOp() && binary->getOpcode() != BO_Comma && IsPure(binary->getLHS()) && IsPure(binary->getRHS());
+	}
+	return (pure_[node] = result);
+}
+
+void TransferFuncs::ClearCaches() {
+	lowered_.clear();
+	pure_.clear();
+	warned_.clear();
+	callee_globals_.clear();
+}
+
+ExpressionState TransferFuncs::Visit(Stmt* node) {
+	Expr * expr = dyn_cast_or_null<Expr>(node);
+	if (!expr || !IsPure(expr))
+		return CFGStmtVisitor<TransferFuncs,ExpressionState>::Visit(node);
+	LoweredKey key(make_pair(expr,tag_),state_.mgr_ptr_);
+	map<LoweredKey,ExpressionState>::const_iterator iter = lowered_.find(key);
+	if (iter == lowered_.end())
+		iter = lowered_.insert(make_pair(key,CFGStmtVisitor<TransferFuncs,ExpressionState>::Visit(node))).first;
+	return (expr_map_[expr] = iter->second);
+}
+
+ExpressionState TransferFuncs::BlockStmt_Visit(Stmt* node) {
+	if (nested_)
+		return CFGStmtVisitor<TransferFuncs,ExpressionState>::BlockStmt_Visit(node);
+	nested_ = true;
+	ExpressionState result;
+	if (Batch(node)) {
+		if (Expr * expr = dyn_cast<Expr>(node))
+			result = expr_map_[expr];
+	} else {
+		Flush();
+		result = CFGStmtVisitor<TransferFuncs,ExpressionState>::BlockStmt_Visit(node);
+	}
+	nested_ = false;
+	return result;
+}
+
+// whether v is assigned by a pending assignment, or one is assigned a variable the expression reads
+bool TransferFuncs::IsPending(const var& v, const environment& expr_env) const {
+	const State::Assignments * lists[] = { &pending_, &pending_guards_ };
+	for (size_t i = 0; i < 2; ++i) {
+		for (State::Assignments::const_iterator iter = lists[i]->begin(), end = lists[i]->end(); iter != end; ++iter) {
+			if (iter->first == v || expr_env.contains(iter->first))
+				return true;
+		}
+	}
+	return false;
+}
+
+/**
+ * Collects the block statement as a pending assignment if its effect is exactly state_[x <- e] for a pure e,
+ * and it neither overwrites nor reads a variable assigned by the pending ones. Sequential assignments of
+ * independent variables are the same as their parallel assignment.
+ */
+bool TransferFuncs::Batch(Stmt* node) {
+	VarDecl * decl = NULL;
+	Expr * value = NULL;
+	BinaryOperator * binary = dyn_cast<BinaryOperator>(node);
+	if (binary) {
+		BinaryOperator::Opcode opcode = binary->getOpcode();
+		if (opcode != BO_Assign && opcode != BO_AddAssign && opcode != BO_SubAssign && opcode != BO_MulAssign)
+			return false;
+		if (DeclRefExpr * ref = dyn_cast<DeclRefExpr>(binary->getLHS()->IgnoreParens()))
+			decl = dyn_cast<VarDecl>(ref->getDecl());
+		value = binary->getRHS();
+	} else if (DeclStmt * decl_stmt = dyn_cast<DeclStmt>(node)) {
+		if (decl_stmt->isSingleDecl())
+			decl = dyn_cast<VarDecl>(decl_stmt->getSingleDecl());
+		if (decl && !decl->getType()->isIntegerType()) // VisitDeclStmt models integers alone
+			return false;
+		value = decl ? decl->getInit() : NULL;
+	}
+	if (!decl || !value || !IsPure(value))
+		return false;
+	const Type * type = decl->getType().getTypePtr();
+	if (!type->isIntegerType() && !type->isFloatingType())
+		return false;
+	bool is_guard = (decl->getType().getAsString() == Defines::kGuardType);
+	// conditions are split into their true and false states, so only guards set to 0/1 are plain assignments
+	if (is_guard) {
+		IntegerLiteral * literal = dyn_cast<IntegerLiteral>(value->IgnoreParenCasts());
+		if ((binary && binary->getOpcode() != BO_Assign) || !literal || literal->getValue().getLimitedValue() > 1)
+			return false;
+	} else if (value->isKnownToHaveBooleanValue()) {
+		return false;
+	}
+	stringstream name;
+	name << (tag_ ? Defines::kTagPrefix : "") << decl->getNameAsString();
+	if ( name.str().find(Defines::kCorrPointPrefix) == 0 )
+		return false;
+	var v(name.str());
+
+	texpr1 expr = Visit(value).e_;
+	if (binary && binary->getOpcode() != BO_Assign) {
+		texpr1 left = Visit(binary->getLHS()).e_;
+		environment env = AnalysisUtils::JoinEnvironments(left.get_environment(),expr.get_environment());
+		left.extend_environment(env);
+		expr.extend_environment(env);
+		switch (binary->getOpcode()) {
+		case BO_AddAssign: expr = texpr1(left + expr); break;
+		case BO_SubAssign: expr = texpr1(left - expr); break;
+		default: expr = texpr1(left * expr); break;
+		}
+	}
+	if (IsPending(v,expr.get_environment()))
+		return false;
+	if (!binary) {
+		// VisitDeclStmt forgets the variable in whichever part holds it, the assignment only overwrites its own part
+		for (AbstractSet::const_iterator iter = state_.abs_set_.begin(), end = state_.abs_set_.end(); iter != end; ++iter) {
+			if ((is_guard ? iter->vars : iter->guards).abstract()->get_environment().contains(v))
+				return false;
+		}
+		if ( !state_.env_.contains(v) )
+			state_.env_ = state_.env_.add(&v,1,0,0);
+	} else {
+		expr_map_[binary] = expr;
+	}
+	(is_guard ? pending_guards_ : pending_).push_back(make_pair(v,expr));
+	return true;
+}
+
+void TransferFuncs::Flush() {
+	if (pending_.empty() && pending_guards_.empty())
+		return;
+	state_.Assign(pending_,pending_guards_);
+	pending_.clear();
+	pending_guards_.clear();
+}
+
+/**
+ * The index variable of an access to the given (untagged) array at the given location: idx_<loc>, or when
+ * pooling, idx_<array>_<slot> where locations are assigned to the array's slots round robin. A location
+ * always gets the same slot, so states joined at merge points agree on the names and no renaming is needed.
+ */
+var TransferFuncs::ArrayIndexVar(const string& array, unsigned int loc) {
+	stringstream index_ss;
+	index_ss << (tag_ ? Defines::kTagPrefix : "") << Defines::kArrayIndexPrefix;
+	if (array_index_pool_size_) {
+		map<unsigned,unsigned> &slots = array_index_slots_[array];
+		if (!slots.count(loc)) {
+			unsigned slot = slots.size() % array_index_pool_size_;
+			slots[loc] = slot;
+		}
+		index_ss << array << "_" << slots[loc];
+	} else {
+		index_ss << loc;
+	}
+	return var(index_ss.str());
+}
+
 void TransferFuncs::AssumeTagEquivalence(State &state, string v, const Type * type){
 	AnalysisUtils::VarType var_type;
 	string v_tag;
@@ -41,6 +226,29 @@ void TransferFuncs::AssumeTagEquivalence(State &state, string v, const Type * ty
 	state &= equal_cons;
 }
 
+void TransferFuncs::AssumeTagDifference(State &state, string v, const Type * type, double low, double high){
+	string v_tag;
+	Utils::Names(v,v_tag);
+	var x(v), x_tag(v_tag);
+	environment &env = state.env_;
+	if (type->isIntegerType()) {
+		if (!env.contains(x))
+			env = env.add(&x,1,0,0);
+		if (!env.contains(x_tag))
+			env = env.add(&x_tag,1,0,0);
+	} else if (type->isFloatingType()) {
+		if (!env.contains(x))
+			env = env.add(0,0,&x,1);
+		if (!env.contains(x_tag))
+			env = env.add(0,0,&x_tag,1);
+	} else {
+		return;
+	}
+	texpr1 diff = texpr1(env,x_tag) - texpr1(env,x);
+	state &= tcons1(diff >= texpr1::builder(env,low));
+	state &= tcons1(diff <= texpr1::builder(env,high));
+}
+
 // forget all guard information and assume equivalence.
 void TransferFuncs::AssumeGuardEquivalence(State &state, string v){
 	string v_tag;
@@ -72,11 +280,7 @@ ExpressionState TransferFuncs::VisitCallExpr(CallExpr *node) {
 	ExpressionState result;
 	const Type * type = node->getCallReturnType().getTypePtr();
 
-	string call;
-	raw_string_ostream call_os(call);
-	call_os << (tag_ ? Defines::kTagPrefix : "");
-	node->printPretty(call_os,analysis_data_ptr_->getContext(),0, PrintingPolicy(LangOptions()));
-	string call_str = Utils::ReplaceAll(call_os.str()," ",""); // remove spaces from call string
+	string call_str = (tag_ ? Defines::kTagPrefix : "") + CallString(node);
 	var v(call_str);
 	environment env;
 	if ( type->isIntegerType() )
@@ -85,14 +289,122 @@ ExpressionState TransferFuncs::VisitCallExpr(CallExpr *node) {
 		result = texpr1(env.add(0,0,&v,1),v);
 	else
 		return result;
-	// assume the value of the function call is the same in both versions (TODO: this may not always be the case)
-	AssumeTagEquivalence(state_,call_str,type);
-	AssumeTagEquivalence(nstate_,call_str,type);
+	map<string,bool>::const_iterator summary = call_summaries_.end();
+	string callee_name;
+	if (const FunctionDecl * callee = node->getDirectCallee()) {
+		callee_name = callee->getNameAsString();
+		summary = call_summaries_.find(callee_name);
+	}
+	// with a summary, the values are the same only if the callee was proven equivalent and gets equal inputs,
+	// otherwise the call result is only bounded by the callee's difference summary (when the inputs are equal)
+	bool inputs_equivalent = summary != call_summaries_.end() && InputsEquivalent(node);
+	if (summary == call_summaries_.end() || (summary->second && inputs_equivalent)) {
+		// assume the value of the function call is the same in both versions (TODO: without a summary this may not always be the case)
+		AssumeTagEquivalence(state_,call_str,type);
+		AssumeTagEquivalence(nstate_,call_str,type);
+	} else if (const FunctionDecl * callee = node->getDirectCallee()) {
+		// the callee may also leave different globals behind, so this version's copies no longer equal the other's
+		const set<string> &globals = CalleeGlobals(callee);
+		for (set<string>::const_iterator iter = globals.begin(), end = globals.end(); iter != end; ++iter) {
+			string name = (tag_ ? Defines::kTagPrefix : "") + *iter;
+			state_.Forget(name);
+			nstate_.Forget(name);
+		}
+		map<string,pair<double,double> >::const_iterator difference = call_differences_.find(callee_name);
+		if (inputs_equivalent && difference != call_differences_.end()) {
+			AssumeTagDifference(state_,call_str,type,difference->second.first,difference->second.second);
+			AssumeTagDifference(nstate_,call_str,type,difference->second.first,difference->second.second);
+		}
+	}
 
 	expr_map_[node] = result;
 	return result;
 }
 
+void TransferFuncs::CollectGlobals(const Stmt * stmt, map<string,const VarDecl*> &globals, set<const FunctionDecl*> &visited) {
+	if (!stmt)
+		return;
+	if (const DeclRefExpr * ref = dyn_cast<DeclRefExpr>(stmt)) {
+		if (const VarDecl * decl = dyn_cast<VarDecl>(ref->getDecl()))
+			if (decl->isFileVarDecl())
+				globals[decl->getNameAsString()] = decl;
+	} else if (const CallExpr * call = dyn_cast<CallExpr>(stmt)) {
+		const FunctionDecl * definition = NULL;
+		if (const FunctionDecl * callee = call->getDirectCallee())
+			if (callee->hasBody(definition) && visited.insert(definition).second)
+				CollectGlobals(definition->getBody(),globals,visited);
+	}
+	for (Stmt::const_child_iterator iter = stmt->child_begin(), end = stmt->child_end(); iter != end; ++iter)
+		CollectGlobals(*iter,globals,visited);
+}
+
+// callees without a body (library functions) are assumed to leave the program's globals alone
+const set<string>& TransferFuncs::CalleeGlobals(const FunctionDecl * callee) {
+	map<const FunctionDecl*,set<string> >::iterator cached = callee_globals_.find(callee);
+	if (cached != callee_globals_.end())
+		return cached->second;
+	set<string> &result = callee_globals_[callee];
+	const FunctionDecl * definition = NULL;
+	if (callee->hasBody(definition)) {
+		map<string,const VarDecl*> globals;
+		set<const FunctionDecl*> visited;
+		visited.insert(definition);
+		CollectGlobals(definition->getBody(),globals,visited);
+		for (map<string,const VarDecl*>::const_iterator iter = globals.begin(), end = globals.end(); iter != end; ++iter)
+			result.insert(iter->first);
+	}
+	return result;
+}
+
+// the (untagged) name of the variable holding the result of the call
+string TransferFuncs::CallString(const CallExpr * node) {
+	string call;
+	raw_string_ostream call_os(call);
+	node->printPretty(call_os,analysis_data_ptr_->getContext(),0, PrintingPolicy(LangOptions()));
+	return Utils::ReplaceAll(call_os.str()," ",""); // remove spaces from call string
+}
+
+// the variables and the results of nested calls (e.g. g(x) in f(g(x))) the arguments depend on
+void TransferFuncs::CollectArgumentVars(const Stmt * stmt, set<string> &names) {
+	if (!stmt)
+		return;
+	if (const DeclRefExpr * ref = dyn_cast<DeclRefExpr>(stmt)) {
+		if (isa<VarDecl>(ref->getDecl()))
+			names.insert(ref->getDecl()->getNameAsString());
+	} else if (const CallExpr * call = dyn_cast<CallExpr>(stmt)) {
+		const Type * type = call->getCallReturnType().getTypePtr();
+		if (type->isIntegerType() || type->isFloatingType())
+			names.insert(CallString(call));
+	}
+	for (Stmt::const_child_iterator iter = stmt->child_begin(), end = stmt->child_end(); iter != end; ++iter)
+		CollectArgumentVars(*iter,names);
+}
+
+// every variable and nested call result in the arguments, and every global the callee refers to (the callee's
+// analysis assumed those equal on entry), is common to both versions and equal in all abstracts of the state
+bool TransferFuncs::InputsEquivalent(CallExpr * node) {
+	set<string> names;
+	for (CallExpr::arg_iterator iter = node->arg_begin(), end = node->arg_end(); iter != end; ++iter)
+		CollectArgumentVars(*iter,names);
+	if (const FunctionDecl * callee = node->getDirectCallee()) {
+		const set<string> &globals = CalleeGlobals(callee);
+		for (set<string>::const_iterator iter = globals.begin(), end = globals.end(); iter != end; ++iter)
+			names.insert(*iter);
+	}
+	manager mgr = *state_.mgr_ptr_;
+	for (AbstractSet::const_iterator abs_iter = state_.abs_set_.begin(), abs_end = state_.abs_set_.end(); abs_iter != abs_end; ++abs_iter) {
+		if (abs_iter->vars.abstract()->is_bottom(mgr))
+			continue;
+		const set<var> &common_vars = abs_iter->vars.CommonVars(), &non_equiv_vars = abs_iter->vars.NonEquivVars();
+		for (set<string>::const_iterator iter = names.begin(), end = names.end(); iter != end; ++iter) {
+			var v(*iter);
+			if (!common_vars.count(v) || non_equiv_vars.count(v))
+				return false;
+		}
+	}
+	return true;
+}
+
 ExpressionState TransferFuncs::VisitParenExpr(ParenExpr *node) {
 	return expr_map_[node] = BlockStmt_Visit(node->getSubExpr());
 }
@@ -127,7 +439,7 @@ ExpressionState TransferFuncs::VisitImplicitCastExpr(ImplicitCastExpr * node) {
 			state_.MeetGuard(tcons1(texpr1(env,name_os.str()) == AnalysisUtils::kOne));
 			nstate_.MeetGuard(tcons1(texpr1(env,name_os.str()) == AnalysisUtils::kZero));
 		} else { // if (v) ; v can be any expression
-			if (expr_map_.count(node) == 0) {// print warning just one time
+			if (warned_.insert(node).second) {// print warning just one time
 				cerr << "Careful! the boolean condition (" << result.e_ <<
 						") will be modeled on the false path as " << tcons1(result.e_ > AnalysisUtils::kZero) <<
 						" V " << tcons1(result.e_ < AnalysisUtils::kZero) <<
@@ -383,25 +695,23 @@ ExpressionState TransferFuncs::VisitBinaryOperator(BinaryOperator* node) {
 			ArraySubscriptExpr* array_subscript_expr = dyn_cast<ArraySubscriptExpr>(rhs->IgnoreParenCasts());
 			assert(array_subscript_expr && "rvalue is pointer but not array.");
 			// create read(A,idx_l)
-			unsigned int loc = node->getLocStart().getRawEncoding();
-			stringstream index_ss;
-			index_ss << (tag_ ? Defines::kTagPrefix : "") << Defines::kArrayIndexPrefix << loc;
-			var index(index_ss.str());
-			if ( !env.contains(index) )
-				env = env.add(&index,1,0,0);
 			stringstream array_ss;
 			array_ss << (tag_ ? Defines::kTagPrefix : "") << right_var_decl_ptr->getNameAsString();
 			var array(array_ss.str());
+			var index = ArrayIndexVar(right_var_decl_ptr->getNameAsString(),node->getLocStart().getRawEncoding());
+			if ( !env.contains(index) )
+				env = env.add(&index,1,0,0);
 			stringstream read_ss;
 			read_ss << Defines::kArrayReadPrefix << "( " << array << " , " << index << " )";
 			var read(read_ss.str());
 			if ( !env.contains(read) )
 				env = env.add(&read,1,0,0);
 			// store the entry for easy retrieval
-			vector<var> vars;
-			vars.push_back(array);
-			vars.push_back(index);
-			state_.read_map_[read] = vars;
+			State::AddArrayRead(read,array,index);
+			if (array_index_pool_size_) { // the slot may hold a read from another location
+				state_.Forget(index);
+				state_.Forget(read);
+			}
 			// state_[v <- read(A,idx_l)] /\ {idx_l = i}
 			state_.Assign(env,left_var,texpr1(env,read));
 			texpr1 index_expr = Visit(array_subscript_expr->getIdx()).e_;
@@ -424,15 +734,12 @@ ExpressionState TransferFuncs::VisitBinaryOperator(BinaryOperator* node) {
 			assert(array_subscript_expr && "lvalue is pointer but not array.");
 
 			// create update(A,idx_l)
-			unsigned int loc = node->getLocStart().getRawEncoding();
-			stringstream index_ss;
-			index_ss << (tag_ ? Defines::kTagPrefix : "") << Defines::kArrayIndexPrefix << loc;
-			var index(index_ss.str());
-			if ( !env.contains(index) )
-				env = env.add(&index,1,0,0);
 			stringstream array_ss;
 			array_ss << (tag_ ? Defines::kTagPrefix : "") << left_var_decl_ptr->getNameAsString();
 			var array(array_ss.str());
+			var index = ArrayIndexVar(left_var_decl_ptr->getNameAsString(),node->getLocStart().getRawEncoding());
+			if ( !env.contains(index) )
+				env = env.add(&index,1,0,0);
 			stringstream update_ss;
 			update_ss << Defines::kArrayUpdatePrefix << "( " << array << " , " << index << " )";
 			var update(update_ss.str());
@@ -440,10 +747,9 @@ ExpressionState TransferFuncs::VisitBinaryOperator(BinaryOperator* node) {
 				env = env.add(&update,1,0,0);
 
 			// store the entry for easy retrieval
-			vector<var> vars;
-			vars.push_back(array);
-			vars.push_back(index);
-			state_.update_map_[update] = vars;
+			State::AddArrayUpdate(update,array,index);
+			if (array_index_pool_size_) // the slot may hold an update from another location
+				state_.Forget(index);
 
 			// state_[update(A,idx_l) <- e] /\ {idx_l = i}
 			state_.Assign(env,update,right_texpr);
@@ -9,6 +9,7 @@
 #define CORRELATINGTRANSFORMER_H_
 
 #include <map>
+#include <set>
 #include <iostream>
 #include <cstdio>
 using namespace std;
@@ -37,7 +38,8 @@ class TransferFuncs : public CFGStmtVisitor<TransferFuncs,ExpressionState> {
 
         State state_, nstate_;
         APAbstractDomain::AnalysisDataTy * analysis_data_ptr_;
-        map<Expr*,ExpressionState> expr_map_;
+        map<Expr*,ExpressionState> expr_map_; // per-block scratch: sub-expression results, reset after each block
+        static set<const Expr*> warned_; // boolean conditions already warned about
         string current_guard_;
         bool report_;
 
@@ -47,14 +49,42 @@ class TransferFuncs : public CFGStmtVisitor<TransferFuncs,ExpressionState> {
         void SetGuard(const set<abstract1> &expr_abs, const set<abstract1> &neg_expr_abs);
         void AssignBoolExprToVar(const var& v, const ExpressionState& expr, environment& env);
 
+        static map< string,map<unsigned,unsigned> > array_index_slots_; // array -> (access location -> pool slot)
+        var ArrayIndexVar(const string& array, unsigned int loc);
+        string CallString(const CallExpr * node);
+        void CollectArgumentVars(const Stmt * stmt, set<string> &names);
+        bool InputsEquivalent(CallExpr * node);
+        static map<const FunctionDecl*,set<string> > callee_globals_; // callee -> the globals it (or its callees) refers to
+        const set<string>& CalleeGlobals(const FunctionDecl * callee);
+
+        // expressions that do not touch the state (variables, literals, arithmetic, conditions) are lowered
+        // once per side and manager, and their texpr1 and condition states reused on every visit
+        typedef pair<pair<const Expr*,bool>,const manager*> LoweredKey;
+        static map<LoweredKey,ExpressionState> lowered_;
+        static map<const Expr*,bool> pure_;
+        bool IsGuard(Expr * node);
+        bool IsPure(Expr * node);
+
+        // consecutive block statements that assign independent variables (x = e, x op= e, int x = e, Guard g = 1)
+        // are collected and applied to state_ as one parallel assignment, before anything else reads the state
+        State::Assignments pending_, pending_guards_;
+        bool nested_; // visiting inside a block statement
+        bool IsPending(const var& v, const environment& expr_env) const;
+        bool Batch(Stmt* node);
+
     public:
 
         bool tag_; // setting this makes the transformer treat all variables as if they are tagged
+        static unsigned array_index_pool_size_; // index variables per array (0 means one per access location)
+        static map<string,bool> call_summaries_; // callee -> proven to return equal values (and leave equal globals) for equal arguments
+        static map<string,pair<double,double> > call_differences_; // callee -> bounds on (ret' - ret) for equal inputs, when it may differ
 
-        TransferFuncs() {}
+        TransferFuncs() : nested_(false) {}
 
-        TransferFuncs(APAbstractDomain::AnalysisDataTy& ad, bool reportResults = false) : tag_(false), analysis_data_ptr_(&ad), report_(reportResults), current_guard_("") { }
+        TransferFuncs(APAbstractDomain::AnalysisDataTy& ad, bool reportResults = false) : tag_(false), analysis_data_ptr_(&ad), report_(reportResults), current_guard_(""), nested_(false) { }
 
+        ExpressionState BlockStmt_Visit(Stmt* node);
+        ExpressionState Visit(Stmt* node);
         ExpressionState VisitDeclRefExpr(DeclRefExpr* node);
         ExpressionState VisitBinaryOperator(BinaryOperator* node);
         ExpressionState VisitUnaryOperator(UnaryOperator* node);
@@ -69,15 +99,22 @@ class TransferFuncs : public CFGStmtVisitor<TransferFuncs,ExpressionState> {
 		ExpressionState VisitForStmt(ForStmt* node);
 		ExpressionState VisitConditionVariableInit(Stmt *node);
 		ExpressionState VisitArraySubscriptExpr(ArraySubscriptExpr *node);
-		void VisitTerminator(CFGBlock* B) { }
+		void VisitTerminator(CFGBlock* B) { Flush(); ResetScratch(); } // called by the dataflow solver after the block's statements
+		void ResetScratch() { expr_map_.clear(); } // sub-expression results are only read within the block that computed them
+		void Flush(); // apply the pending assignments
 		VarDecl*   FindBlockVarDecl(Expr* node);
 
-		State& getVal()  { return state_; }
+		State& getVal()  { Flush(); return state_; }
         State& getNVal() { return nstate_; }
         CFG& getCFG() 	 { return analysis_data_ptr_->getCFG(); }
+        ASTContext& getContext() { return analysis_data_ptr_->getContext(); }
 
         static void AssumeTagEquivalence(State &state, string v, const Type * type);
+        static void AssumeTagDifference(State &state, string v, const Type * type, double low, double high); // low <= v' - v <= high
 		static void AssumeGuardEquivalence(State &state, string v);
+		static void ClearCaches(); // forget the lowered expressions (and the states they hold), call between functions
+		// the globals the statement refers to, and those of the functions it (transitively) calls that have a body
+		static void CollectGlobals(const Stmt * stmt, map<string,const VarDecl*> &globals, set<const FunctionDecl*> &visited);
 
     };
 
@@ -0,0 +1,183 @@
+/*
+ * VariablePacks.cpp
+ */
+
+#include "VariablePacks.h"
+#include "AnalysisUtils.h"
+#include "../Utils.h"
+
+#include <clang/AST/Decl.h>
+#include <clang/AST/Expr.h>
+#include <clang/AST/Stmt.h>
+
+namespace differential {
+
+bool VariablePacks::enabled_ = false;
+map<string,string> VariablePacks::parent_;
+
+// packs are kept over untagged names, so v and v' always share one.
+// array instrumentation variables (indices, reads) are not visible syntactically and share the "" pack.
+string VariablePacks::Key(const string &name) {
+	if (AnalysisUtils::IsArrayInstrumentationVar(var(name)))
+		return "";
+	string untagged = name, tagged;
+	Utils::Names(untagged,tagged);
+	return untagged;
+}
+
+string VariablePacks::Find(const string &name) {
+	string key = Key(name);
+	if (!parent_.count(key))
+		return key;
+	string root = key;
+	while (parent_[root] != root)
+		root = parent_[root];
+	// path compression
+	while (parent_[key] != root) {
+		string next = parent_[key];
+		parent_[key] = root;
+		key = next;
+	}
+	return root;
+}
+
+void VariablePacks::Union(const string &name, const string &other_name) {
+	string root = Find(name), other_root = Find(other_name);
+	if (!parent_.count(root))
+		parent_[root] = root;
+	if (!parent_.count(other_root))
+		parent_[other_root] = other_root;
+	if (root != other_root)
+		parent_[other_root] = root;
+}
+
+void VariablePacks::UnionAll(const Stmt * stmt) {
+	vector<const VarDecl *> decls;
+	Utils::CollectVarDecls(stmt,decls);
+	vector<string> names;
+	for (size_t i = 0; i < decls.size(); ++i)
+		names.push_back(decls[i]->getNameAsString());
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (!parent_.count(Find(names[i])))
+			parent_[Find(names[i])] = Find(names[i]);
+		if (i)
+			Union(names[0],names[i]);
+	}
+}
+
+void VariablePacks::AddCFG(const CFG &cfg) {
+	for (CFG::const_iterator block_iter = cfg.begin(), block_end = cfg.end(); block_iter != block_end; ++block_iter) {
+		const CFGBlock * block = *block_iter;
+		for (CFGBlock::const_iterator iter = block->begin(), end = block->end(); iter != end; ++iter) {
+			CFGElement e = *iter;
+			if (const CFGStmt * statement = e.getAs<CFGStmt>())
+				UnionAll(statement->getStmt());
+		}
+		UnionAll(block->getTerminatorCondition());
+	}
+}
+
+// union-find over the pack roots of a single abstract, merged by the constraints that cross packs
+static string FindMerged(map<string,string> &merged, string root) {
+	while (merged.count(root) && merged[root] != root)
+		root = merged[root];
+	return root;
+}
+
+/**
+ * Splits the abstract into independent abstracts over the packs of its variables, in a single pass
+ * over its constraints: each constraint goes to the pack of its variables, and packs that a constraint
+ * relates are merged for this abstract. The conjunction of the parts is exactly the abstract, and no
+ * dimension is projected out to get them. Only the parts holding a wanted variable are built.
+ */
+vector<abstract1> VariablePacks::Split(const abstract1 &abs, const set<var> &wanted, map<var,size_t> &part_of) {
+	manager mgr = abs.get_manager();
+	environment env = abs.get_environment();
+	const size_t size = env.intdim() + env.realdim();
+	vector<string> packs(size);
+	for (size_t i = 0; i < size; ++i)
+		packs[i] = Find(env.get_var(i));
+
+	map<string,string> merged;
+	ap_lincons1_array_t constraints = ap_abstract1_to_lincons_array(mgr.get_ap_manager_t(),const_cast<ap_abstract1_t*>(abs.get_ap_abstract1_t()));
+	ap_lincons0_array_t &array = constraints.lincons0_array;
+	vector<ap_dim_t> first_dims(array.size,AP_DIM_MAX);
+	for (size_t i = 0; i < array.size; ++i) {
+		size_t k;
+		ap_dim_t dim;
+		ap_coeff_t * coeff;
+		ap_linexpr0_ForeachLinterm(array.p[i].linexpr0,k,dim,coeff) {
+			if (ap_coeff_zero(coeff))
+				continue;
+			if (first_dims[i] == AP_DIM_MAX) {
+				first_dims[i] = dim;
+				continue;
+			}
+			string root = FindMerged(merged,packs[first_dims[i]]), other_root = FindMerged(merged,packs[dim]);
+			if (root != other_root)
+				merged[other_root] = root;
+		}
+	}
+
+	// the dimensions of each part, in the order of the environment (integers first)
+	map<string,vector<ap_dim_t> > dims;
+	set<string> wanted_roots;
+	for (size_t i = 0; i < size; ++i) {
+		string root = FindMerged(merged,packs[i]);
+		dims[root].push_back(i);
+		if (wanted.count(env.get_var(i)))
+			wanted_roots.insert(root);
+	}
+	vector<ap_dim_t> renamed(size);
+	vector<abstract1> result;
+	for (map<string,vector<ap_dim_t> >::const_iterator iter = dims.begin(), end = dims.end(); iter != end; ++iter) {
+		const string &root = iter->first;
+		const vector<ap_dim_t> &part = iter->second;
+		if (!wanted_roots.count(root))
+			continue;
+		vector<var> int_vars, real_vars;
+		for (size_t j = 0; j < part.size(); ++j) {
+			renamed[part[j]] = j;
+			part_of[env.get_var(part[j])] = result.size();
+			if (part[j] < env.intdim())
+				int_vars.push_back(env.get_var(part[j]));
+			else
+				real_vars.push_back(env.get_var(part[j]));
+		}
+		vector<size_t> owned;
+		for (size_t i = 0; i < array.size; ++i)
+			if (first_dims[i] != AP_DIM_MAX && FindMerged(merged,packs[first_dims[i]]) == root)
+				owned.push_back(i);
+		ap_lincons0_array_t part_array = ap_lincons0_array_make(owned.size());
+		for (size_t j = 0; j < owned.size(); ++j) {
+			ap_lincons0_t &cons = array.p[owned[j]];
+			size_t terms = 0, k;
+			ap_dim_t dim;
+			ap_coeff_t * coeff;
+			ap_linexpr0_ForeachLinterm(cons.linexpr0,k,dim,coeff)
+				if (!ap_coeff_zero(coeff))
+					++terms;
+			ap_linexpr0_t * expr = ap_linexpr0_alloc(AP_LINEXPR_SPARSE,terms);
+			ap_coeff_set(&expr->cst,&cons.linexpr0->cst);
+			size_t term = 0;
+			ap_linexpr0_ForeachLinterm(cons.linexpr0,k,dim,coeff) {
+				if (ap_coeff_zero(coeff))
+					continue;
+				expr->p.linterm[term].dim = renamed[dim];
+				ap_coeff_set(&expr->p.linterm[term].coeff,coeff);
+				++term;
+			}
+			part_array.p[j] = ap_lincons0_make(cons.constyp,expr,cons.scalar ? ap_scalar_alloc_set(cons.scalar) : NULL);
+		}
+		environment part_env(int_vars,real_vars);
+		ap_abstract1_t part_abs;
+		part_abs.abstract0 = ap_abstract0_of_lincons_array(mgr.get_ap_manager_t(),int_vars.size(),real_vars.size(),&part_array);
+		part_abs.env = ap_environment_copy(const_cast<ap_environment_t*>(part_env.get_ap_environment_t()));
+		result.push_back(abstract1(part_abs));
+		ap_lincons0_array_clear(&part_array);
+	}
+	ap_lincons1_array_clear(&constraints);
+	return result;
+}
+
+}
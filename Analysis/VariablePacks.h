@@ -0,0 +1,49 @@
+/*
+ * VariablePacks.h
+ *
+ * Groups program variables into packs by syntactic dependency: variables that appear together
+ * in a statement or a branch condition end up in the same pack (union-find), and v, v' always
+ * share a pack. The packs only change how equivalence queries are answered: the states still hold
+ * one abstract over all the variables, and each query runs on the part of that abstract that
+ * constrains the pack (split off its constraints, without projecting), which is exact and much
+ * cheaper than querying the full abstract per variable. The split happens once per interned
+ * abstract, since its non-equivalent variables are cached.
+ */
+
+#ifndef VARIABLE_PACKS_H
+#define VARIABLE_PACKS_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include <clang/Analysis/CFG.h>
+using namespace clang;
+
+#include "apronxx/apronxx.hh"
+using namespace apron;
+
+namespace differential {
+
+class VariablePacks {
+	static map<string,string> parent_; // union-find over untagged variable names
+
+	static string Key(const string &name);
+	static void UnionAll(const Stmt * stmt);
+
+public:
+	static bool enabled_;
+
+	static void Clear() { parent_.clear(); }
+	static void AddCFG(const CFG &cfg);
+	static void Union(const string &name, const string &other_name);
+	static string Find(const string &name);
+	// the abstract as independent abstracts, one per (merged) pack holding a wanted variable, part_of maps their variables to their part
+	static vector<abstract1> Split(const abstract1 &abs, const set<var> &wanted, map<var,size_t> &part_of);
+};
+
+}
+
+#endif // VARIABLE_PACKS_H
@@ -8,6 +8,8 @@
 
 #include "Analyzer.h"
 #include "Analysis/AnalysisConfiguration.h"
+#include "Analysis/VariablePacks.h"
+#include "Analysis/FixpointStore.h"
 
 #include "DTL/dtl.hpp"
 #include "DTL/variables.hpp"
@@ -25,7 +27,12 @@ extern llvm::cl::list<string> IgnoredParams;
 extern llvm::cl::list<string> DefinedMacros;
 extern llvm::cl::list<string> IncludeDirs;
 extern llvm::cl::list<string> ManagerType;
+extern llvm::cl::list<string> CascadeManagerType;
 extern llvm::cl::list<string> ComputeDiff;
+extern llvm::cl::list<string> ReportLines;
+extern llvm::cl::list<string> VariablePacking;
+extern llvm::cl::list<string> ArrayIndexPool;
+extern llvm::cl::list<string> WarmStart;
 extern llvm::cl::list<string> PartitionPoint;
 extern llvm::cl::list<string> PartitionStrategy;
 extern llvm::cl::list<string> PartitonThreshold;
@@ -46,6 +53,11 @@ namespace differential {
     Analyzer::Analyzer() : CodeHandler(InputFilename) {
     	AnalysisConfiguration::PrintConfigurationHeader();
     	APAbstractDomain::ValTy::mgr_ptr_ = AnalysisConfiguration::ParseManager(ManagerType);
+    	APAbstractDomain::ValTy::cascade_mgr_ptr_ = AnalysisConfiguration::ParseCascadeManager(CascadeManagerType);
+    	VariablePacks::enabled_ = AnalysisConfiguration::ParseVariablePacking(VariablePacking);
+    	TransferFuncs::array_index_pool_size_ = AnalysisConfiguration::ParseArrayIndexPool(ArrayIndexPool);
+    	FixpointStore::directory_ = AnalysisConfiguration::ParseWarmStart(WarmStart);
+    	APChecker::report_lines_ = AnalysisConfiguration::ParseReportLines(ReportLines);
     	APAbstractDomain::ValTy::partition_point_ = AnalysisConfiguration::ParsePartitionPoint(PartitionPoint);
     	APAbstractDomain::ValTy::partition_strategy_ = AnalysisConfiguration::ParsePartitionStrategy(PartitionStrategy);
     	APAbstractDomain::ValTy::widening_point_ = AnalysisConfiguration::ParseWideningPoint(WideningPoint);
@@ -13,7 +13,12 @@ llvm::cl::opt<string>  InputFilename(llvm::cl::Positional, llvm::cl::desc("filen
 
 // Analysis Flags:
 llvm::cl::list<string> ManagerType("m",llvm::cl::value_desc(differential::AnalysisConfiguration::kManagerTypes),llvm::cl::desc("Type of constraint manager for apron"));
+llvm::cl::list<string> CascadeManagerType("m_c",llvm::cl::value_desc(differential::AnalysisConfiguration::kManagerTypes),llvm::cl::desc("Re-analyze with this manager where the one given by -m can not prove equivalence"));
 llvm::cl::list<string> ComputeDiff("diff",llvm::cl::value_desc("flag"),llvm::cl::desc("Compute diff over all states (instead of just showing offendifng states)"));
+llvm::cl::list<string> ReportLines("report_lines",llvm::cl::value_desc("lines"),llvm::cl::desc("Comma separated lines of the correlation points to compute and report deltas at (default: all)"));
+llvm::cl::list<string> VariablePacking("pack",llvm::cl::value_desc("flag"),llvm::cl::desc("Answer equivalence queries pack by pack (variables grouped by syntactic dependency)"));
+llvm::cl::list<string> ArrayIndexPool("arr_pool",llvm::cl::value_desc("positive integer"),llvm::cl::desc("Number of index variables per array (reused across access locations)"));
+llvm::cl::list<string> WarmStart("warm",llvm::cl::value_desc("directory"),llvm::cl::desc("Start from (and store) the fixpoints of functions analyzed before with the same body and configuration"));
 llvm::cl::list<string> PartitionPoint("p_p",llvm::cl::value_desc(differential::AnalysisConfiguration::kPartitionPoints),llvm::cl::desc("Partition Point"));
 llvm::cl::list<string> PartitionStrategy("p_s",llvm::cl::value_desc(differential::AnalysisConfiguration::kPartitionStrategies),llvm::cl::desc("Partition Strategy"));
 llvm::cl::list<string> WideningPoint("w_p",llvm::cl::value_desc(differential::AnalysisConfiguration::kWideningPoints),llvm::cl::desc("Widening Point"));
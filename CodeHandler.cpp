@@ -34,7 +34,10 @@ CodeHandler::CodeHandler(string filename)  :
     				text_diag_printer_(new TextDiagnosticPrinter(llvm::errs(), diagnostic_options_)),
     				contex_ptr(0)
 {
-	const FileEntry *file_entry_ptr = file_manager_.getFile(filename);
+	// a file produced by an earlier stage of the in-process pipeline is read from memory
+	map<string,string>::const_iterator memory_file = Utils::memory_files_.find(filename);
+	bool in_memory = (memory_file != Utils::memory_files_.end());
+	const FileEntry *file_entry_ptr = in_memory ? file_manager_.getVirtualFile(filename,memory_file->second.size(),0) : file_manager_.getFile(filename);
 	if ( !file_entry_ptr ) {
 		cerr << "Failed to open \'" << filename << "\'" << endl;
 		exit(1);
@@ -99,6 +102,8 @@ CodeHandler::CodeHandler(string filename)  :
 	preprocessor_ptr_->setPredefines(&predefineBuffer[0]);
 
 	text_diag_printer_->BeginSourceFile(language_options_, preprocessor_ptr_);
+	if ( in_memory )
+		source_manager_.overrideFileContents(file_entry_ptr, llvm::MemoryBuffer::getMemBufferCopy(memory_file->second,filename));
 	source_manager_.createMainFileID(file_entry_ptr);
 }
 
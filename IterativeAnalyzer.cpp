@@ -12,6 +12,10 @@ using namespace apron;
 #include "Analysis/APAbstractDomain.h"
 #include "Analysis/IterativeSolver.h"
 #include "Analysis/AnalysisConfiguration.h"
+#include "Analysis/VariablePacks.h"
+#include "Analysis/FixpointStore.h"
+
+#include <clang/Lex/Lexer.h>
 
 #include "DTL/dtl.hpp"
 #include "DTL/variables.hpp"
@@ -22,6 +26,10 @@ using namespace dtl;
 #include <fstream>
 #include <string>
 #include <map>
+#include <set>
+#include <list>
+#include <vector>
+#include <algorithm>
 using namespace std;
 
 #define DEBUG 0
@@ -32,6 +40,10 @@ extern llvm::cl::list<string> IgnoredParams;
 extern llvm::cl::list<string> DefinedMacros;
 extern llvm::cl::list<string> IncludeDirs;
 extern llvm::cl::list<string> ManagerType;
+extern llvm::cl::list<string> VariablePacking;
+extern llvm::cl::list<string> ArrayIndexPool;
+extern llvm::cl::list<string> LivenessProjection;
+extern llvm::cl::list<string> WarmStart;
 extern llvm::cl::list<string> PartitionPoint;
 extern llvm::cl::list<string> PartitionStrategy;
 extern llvm::cl::list<string> WideningPoint;
@@ -40,6 +52,14 @@ extern llvm::cl::list<string> WideningThreshold;
 extern llvm::cl::list<string> Interleaving;
 extern llvm::cl::list<string> InterleavingLookaheadWindow;
 extern llvm::cl::list<string> InterleavingLookaheadPartition;
+extern llvm::cl::list<string> AdaptiveLookahead;
+extern llvm::cl::list<string> LookaheadCap;
+extern llvm::cl::list<string> LookaheadTimeBudget;
+extern llvm::cl::list<string> Lockstep;
+extern llvm::cl::list<string> ObservableCallees;
+extern llvm::cl::list<string> ReportPairs;
+extern llvm::cl::list<string> ChangeImpact;
+extern llvm::cl::list<string> CallSummaries;
 extern llvm::cl::list<string> ProveEquiv;
 
 namespace differential {
@@ -52,6 +72,198 @@ namespace differential {
 
     IterativeAnalyzer::IterativeAnalyzer() {  }
 
+    /**
+     * Hash of the tokens of the function definition (signature and body), so whitespace and
+     * comments do not count as a change.
+     */
+    uint64_t IterativeAnalyzer::HashTokens(const FunctionDecl * fd, ASTContext &contex) {
+    	SourceManager &source_manager = contex.getSourceManager();
+    	SourceLocation begin = source_manager.getExpansionLoc(fd->getSourceRange().getBegin()),
+    			end = source_manager.getExpansionLoc(fd->getSourceRange().getEnd());
+    	pair<FileID,unsigned> begin_info = source_manager.getDecomposedLoc(begin), end_info = source_manager.getDecomposedLoc(end);
+    	bool invalid = false;
+    	StringRef buffer = source_manager.getBufferData(begin_info.first,&invalid);
+    	uint64_t hash = 14695981039346656037ULL; // FNV-1a
+    	if (invalid || begin_info.first != end_info.first)
+    		return hash;
+    	Lexer lexer(source_manager.getLocForStartOfFile(begin_info.first),contex.getLangOptions(),
+    			buffer.begin(),buffer.begin() + begin_info.second,buffer.end());
+    	Token token;
+    	while (!lexer.LexFromRawLexer(token)) {
+    		unsigned offset = source_manager.getFileOffset(token.getLocation());
+    		if (offset > end_info.second)
+    			break;
+    		for (unsigned i = 0; i < token.getLength(); ++i)
+    			hash = (hash ^ (unsigned char)buffer[offset + i]) * 1099511628211ULL;
+    		hash = (hash ^ ' ') * 1099511628211ULL; // token separator
+    	}
+    	return hash;
+    }
+
+    /**
+     * Hash of the tokens of the main file outside the function definitions: macros, types, globals,
+     * prototypes and includes. The function hashes are of the raw (unexpanded) tokens, so when any
+     * of these differ a function with identical tokens may still mean something else.
+     */
+    uint64_t IterativeAnalyzer::HashOutsideFunctions(const map<string,const FunctionDecl*> &functions, ASTContext &contex) {
+    	SourceManager &source_manager = contex.getSourceManager();
+    	FileID main_file = source_manager.getMainFileID();
+    	map<unsigned,unsigned> ranges; // begin offset -> end offset of every function definition in the main file
+    	for (map<string,const FunctionDecl*>::const_iterator iter = functions.begin(), end = functions.end(); iter != end; ++iter) {
+    		pair<FileID,unsigned> begin_info = source_manager.getDecomposedLoc(source_manager.getExpansionLoc(iter->second->getSourceRange().getBegin())),
+    				end_info = source_manager.getDecomposedLoc(source_manager.getExpansionLoc(iter->second->getSourceRange().getEnd()));
+    		if (begin_info.first == main_file && end_info.first == main_file)
+    			ranges[begin_info.second] = end_info.second;
+    	}
+    	bool invalid = false;
+    	StringRef buffer = source_manager.getBufferData(main_file,&invalid);
+    	uint64_t hash = 14695981039346656037ULL; // FNV-1a
+    	if (invalid)
+    		return hash;
+    	Lexer lexer(source_manager.getLocForStartOfFile(main_file),contex.getLangOptions(),buffer.begin(),buffer.begin(),buffer.end());
+    	Token token;
+    	while (!lexer.LexFromRawLexer(token)) {
+    		unsigned offset = source_manager.getFileOffset(token.getLocation());
+    		map<unsigned,unsigned>::const_iterator range = ranges.upper_bound(offset);
+    		if (range != ranges.begin() && offset <= (--range)->second)
+    			continue; // inside a function definition
+    		for (unsigned i = 0; i < token.getLength(); ++i)
+    			hash = (hash ^ (unsigned char)buffer[offset + i]) * 1099511628211ULL;
+    		hash = (hash ^ ' ') * 1099511628211ULL; // token separator
+    	}
+    	return hash;
+    }
+
+    void IterativeAnalyzer::CollectCallees(const Stmt * stmt, set<string> &callees) {
+    	if (!stmt)
+    		return;
+    	if (const CallExpr * call = dyn_cast<CallExpr>(stmt))
+    		if (const FunctionDecl * callee = call->getDirectCallee())
+    			callees.insert(callee->getNameAsString());
+    	for (Stmt::const_child_iterator iter = stmt->child_begin(), end = stmt->child_end(); iter != end; ++iter)
+    		CollectCallees(*iter,callees);
+    }
+
+    // caller -> callees
+    void IterativeAnalyzer::AddCalls(const map<string,const FunctionDecl*> &functions, map<string,set<string> > &calls) {
+    	for (map<string,const FunctionDecl*>::const_iterator iter = functions.begin(), end = functions.end(); iter != end; ++iter)
+    		CollectCallees(iter->second->getBody(),calls[iter->first]);
+    }
+
+    /**
+     * The functions whose tokens differ between the versions (or that exist in only one of them),
+     * and all their transitive callers in either version. Any other function calls only unchanged
+     * code and is itself unchanged, so its analysis can not show a difference.
+     * If anything outside the function definitions differs (e.g. a macro), every function is impacted.
+     */
+    set<string> IterativeAnalyzer::ImpactedFunctions(const map<string,const FunctionDecl*> &functions, ASTContext &contex,
+    		const map<string,const FunctionDecl*> &functions2, ASTContext &contex2, const map<string,set<string> > &calls) {
+    	list<string> worklist;
+    	bool outside_changed = (HashOutsideFunctions(functions,contex) != HashOutsideFunctions(functions2,contex2));
+    	for (map<string,const FunctionDecl*>::const_iterator iter = functions.begin(), end = functions.end(); iter != end; ++iter) {
+    		map<string,const FunctionDecl*>::const_iterator iter2 = functions2.find(iter->first);
+    		if (outside_changed || iter2 == functions2.end() || HashTokens(iter->second,contex) != HashTokens(iter2->second,contex2))
+    			worklist.push_back(iter->first);
+    	}
+    	for (map<string,const FunctionDecl*>::const_iterator iter2 = functions2.begin(), end2 = functions2.end(); iter2 != end2; ++iter2)
+    		if (!functions.count(iter2->first))
+    			worklist.push_back(iter2->first);
+    	map<string,set<string> > callers;
+    	for (map<string,set<string> >::const_iterator iter = calls.begin(), end = calls.end(); iter != end; ++iter)
+    		for (set<string>::const_iterator callee = iter->second.begin(), callees_end = iter->second.end(); callee != callees_end; ++callee)
+    			callers[*callee].insert(iter->first);
+    	set<string> result;
+    	while (!worklist.empty()) {
+    		string name = worklist.front();
+    		worklist.pop_front();
+    		if (!result.insert(name).second)
+    			continue;
+    		const set<string> &name_callers = callers[name];
+    		worklist.insert(worklist.end(),name_callers.begin(),name_callers.end());
+    	}
+    	return result;
+    }
+
+    // Tarjan's algorithm: a component is emitted after all the components it reaches, i.e. callees first
+    static void StrongConnect(const string &name, const set<string> &names, const map<string,set<string> > &calls,
+    		map<string,unsigned> &index, map<string,unsigned> &lowlink, vector<string> &stack, set<string> &on_stack,
+    		vector<vector<string> > &result) {
+    	unsigned visit = index.size();
+    	index[name] = lowlink[name] = visit;
+    	stack.push_back(name);
+    	on_stack.insert(name);
+    	map<string,set<string> >::const_iterator callees = calls.find(name);
+    	if (callees != calls.end()) {
+    		for (set<string>::const_iterator iter = callees->second.begin(), end = callees->second.end(); iter != end; ++iter) {
+    			if (!names.count(*iter))
+    				continue;
+    			if (!index.count(*iter)) {
+    				StrongConnect(*iter,names,calls,index,lowlink,stack,on_stack,result);
+    				lowlink[name] = min(lowlink[name],lowlink[*iter]);
+    			} else if (on_stack.count(*iter)) {
+    				lowlink[name] = min(lowlink[name],index[*iter]);
+    			}
+    		}
+    	}
+    	if (lowlink[name] != index[name])
+    		return;
+    	vector<string> component;
+    	string member;
+    	do {
+    		member = stack.back();
+    		stack.pop_back();
+    		on_stack.erase(member);
+    		component.push_back(member);
+    	} while (member != name);
+    	result.push_back(component);
+    }
+
+    vector<vector<string> > IterativeAnalyzer::CallGraphSCCs(const set<string> &names, const map<string,set<string> > &calls) {
+    	map<string,unsigned> index, lowlink;
+    	vector<string> stack;
+    	set<string> on_stack;
+    	vector<vector<string> > result;
+    	for (set<string>::const_iterator iter = names.begin(), end = names.end(); iter != end; ++iter)
+    		if (!index.count(*iter))
+    			StrongConnect(*iter,names,calls,index,lowlink,stack,on_stack,result);
+    	return result;
+    }
+
+    // runs the dual analysis of a function pair, returns whether the versions were proven equivalent to a caller
+    bool IterativeAnalyzer::AnalyzePair(const FunctionDecl * fd, const FunctionDecl * fd2, CodeHandler &code, ASTContext &contex,
+    		AnalysisContextManager &context_manager, int k, int p) {
+		CFG * cfg_ptr = context_manager.getContext(fd)->getCFG(), * cfg2_ptr = context_manager.getContext(fd2)->getCFG();
+#if (DEBUG)
+		cerr << "Found both cfgs for " << fd->getNameAsString() << ":\n";
+		cfg_ptr->dump(LangOptions());
+		cfg2_ptr->dump(LangOptions());
+		getchar();
+#endif
+		// this codes sets up the observer to use the first cfg
+		// an observer is what we used to report the results
+		// this could be defined using the second cfg as well
+		GuardBDD::Clear(); // the guards (and their order) of the previous pair are of no use here
+		TransferFuncs::ClearCaches();
+		APAbstractDomain domain(*cfg_ptr);
+		domain.InitializeValues(*cfg_ptr);
+		APChecker Observer(contex,code.getDiagnosticsEngine(), code.getPreprocessor());
+		domain.getAnalysisData().Observer = &Observer;
+		domain.getAnalysisData().setContext(contex);
+		IterativeSolver is(domain,k,p);
+		is.AssumeInputEquivalence(fd,fd2);
+		if (IterativeSolver::liveness_projection_)
+			is.SetLiveness(context_manager.getContext(fd)->getAnalysis<LiveVariables>(),
+					context_manager.getContext(fd2)->getAnalysis<LiveVariables>());
+		is.RunOnCFGs(cfg_ptr,cfg2_ptr);
+		bool equivalent = is.ExitEquivalent(*cfg_ptr,*cfg2_ptr);
+		// when it may differ, keep how far apart the return values can be (for callers passing equal inputs)
+		double low, high;
+		TransferFuncs::call_differences_.erase(fd->getNameAsString());
+		if (!equivalent && is.ReturnDifference(*cfg_ptr,*cfg2_ptr,low,high))
+			TransferFuncs::call_differences_[fd->getNameAsString()] = make_pair(low,high);
+		return equivalent;
+    }
+
     /**
      * Run the analysis on 2 files
      */
@@ -62,6 +274,10 @@ namespace differential {
 		}
     	AnalysisConfiguration::PrintConfigurationHeader();
     	APAbstractDomain::ValTy::mgr_ptr_ = AnalysisConfiguration::ParseManager(ManagerType);
+    	VariablePacks::enabled_ = AnalysisConfiguration::ParseVariablePacking(VariablePacking);
+    	TransferFuncs::array_index_pool_size_ = AnalysisConfiguration::ParseArrayIndexPool(ArrayIndexPool);
+    	IterativeSolver::liveness_projection_ = AnalysisConfiguration::ParseLivenessProjection(LivenessProjection);
+    	FixpointStore::directory_ = AnalysisConfiguration::ParseWarmStart(WarmStart);
     	APAbstractDomain::ValTy::partition_point_ = AnalysisConfiguration::ParsePartitionPoint(PartitionPoint);
     	APAbstractDomain::ValTy::partition_strategy_ = AnalysisConfiguration::ParsePartitionStrategy(PartitionStrategy);
     	APAbstractDomain::ValTy::widening_point_ = AnalysisConfiguration::ParseWideningPoint(WideningPoint);
@@ -69,6 +285,14 @@ namespace differential {
     	APAbstractDomain::ValTy::widening_threshold_ = AnalysisConfiguration::ParseWideningThreshold(WideningThreshold);
     	int k = AnalysisConfiguration::ParseInterleavignLookaheadWindow(InterleavingLookaheadWindow);
     	int p = AnalysisConfiguration::ParseInterleavignLookaheadPartition(InterleavingLookaheadPartition);
+    	IterativeSolver::adaptive_lookahead_ = AnalysisConfiguration::ParseAdaptiveLookahead(AdaptiveLookahead);
+    	IterativeSolver::lookahead_cap_ = AnalysisConfiguration::ParseLookaheadCap(LookaheadCap,MAX_K);
+    	IterativeSolver::lookahead_time_budget_ = AnalysisConfiguration::ParseLookaheadTimeBudget(LookaheadTimeBudget);
+    	IterativeSolver::lockstep_ = AnalysisConfiguration::ParseLockstep(Lockstep);
+    	IterativeSolver::observable_callees_ = AnalysisConfiguration::ParseObservableCallees(ObservableCallees);
+    	IterativeSolver::report_pairs_ = AnalysisConfiguration::ParseReportPairs(ReportPairs);
+    	bool change_impact = AnalysisConfiguration::ParseChangeImpact(ChangeImpact);
+    	bool call_summaries = AnalysisConfiguration::ParseCallSummaries(CallSummaries);
     	AnalysisConfiguration::PrintConfigurationFooter();
 
     	// extract an AST from each of the files
@@ -80,36 +304,65 @@ namespace differential {
 		map<string,const FunctionDecl*> functions, functions2;
 		Utils::CreateFunctionsMap(contex_ptr->getTranslationUnitDecl(),functions);
 		Utils::CreateFunctionsMap(contex2_ptr->getTranslationUnitDecl(),functions2);
+		map<string,set<string> > calls;
+		if (change_impact || call_summaries) {
+			AddCalls(functions,calls);
+			AddCalls(functions2,calls);
+		}
+		set<string> impacted;
+		if (change_impact) {
+			impacted = ImpactedFunctions(functions,*contex_ptr,functions2,*contex2_ptr,calls);
+			cerr << impacted.size() << " function(s) impacted by the change.\n";
+		}
+
+		// the function pairs to analyze, in name order or (with summaries) bottom-up over the call graph
+		set<string> names;
+		for (map<string,const FunctionDecl*>::const_iterator iter = functions.begin(), end = functions.end(); iter != end; ++iter)
+			if (iter->second->isThisDeclarationADefinition() && functions2.count(iter->first)) // matched in the 2nd AST
+				names.insert(iter->first);
+		vector<vector<string> > order;
+		if (call_summaries) {
+			order = CallGraphSCCs(names,calls);
+		} else {
+			for (set<string>::const_iterator iter = names.begin(), end = names.end(); iter != end; ++iter)
+				order.push_back(vector<string>(1,*iter));
+		}
 
     	// the context manager is needed to produce a CFG
 		AnalysisContextManager context_manager;
 		// iterate over functions, match them, and perform the dual analysis
-		for (map<string,const FunctionDecl*>::const_iterator iter = functions.begin(), end = functions.end(); iter != end; ++iter) {
-			const FunctionDecl* fd = iter->second;
-			if (!fd->isThisDeclarationADefinition())
-				continue;
-			const FunctionDecl* fd2 = functions2[iter->first];
-			if (!fd2) // no matching for the function in the 2nd AST
-				continue;
-			CFG * cfg_ptr = context_manager.getContext(fd)->getCFG(), * cfg2_ptr = context_manager.getContext(fd2)->getCFG();
-#if (DEBUG)
-			cerr << "Found both cfgs for " << iter->first << ":\n";
-			cfg_ptr->dump(LangOptions());
-			cfg2_ptr->dump(LangOptions());
-			getchar();
-#endif
-			// this codes sets up the observer to use the first cfg
-			// an observer is what we used to report the results
-			// this could be defined using the second cfg as well
-			APAbstractDomain domain(*cfg_ptr);
-			domain.InitializeValues(*cfg_ptr);
-			APChecker Observer(*contex_ptr,code.getDiagnosticsEngine(), code.getPreprocessor());
-			domain.getAnalysisData().Observer = &Observer;
-			domain.getAnalysisData().setContext(*contex_ptr);
-			IterativeSolver is(domain,k,p);
-			is.AssumeInputEquivalence(fd,fd2);
-			is.RunOnCFGs(cfg_ptr,cfg2_ptr);
-
+		for (vector<vector<string> >::const_iterator component = order.begin(), order_end = order.end(); component != order_end; ++component) {
+			// calls within a recursive component are first assumed equivalent, and the component is
+			// re-analyzed until no member loses its summary (summaries only go from equivalent to not)
+			bool recursive = component->size() > 1 || calls[component->front()].count(component->front());
+			if (call_summaries && recursive)
+				for (vector<string>::const_iterator iter = component->begin(), end = component->end(); iter != end; ++iter)
+					TransferFuncs::call_summaries_[*iter] = true;
+			bool changed = true;
+			while (changed) {
+				changed = false;
+				for (vector<string>::const_iterator iter = component->begin(), end = component->end(); iter != end; ++iter) {
+					if (change_impact && !impacted.count(*iter)) { // neither it nor anything it calls changed
+						if (call_summaries)
+							TransferFuncs::call_summaries_[*iter] = true;
+						continue;
+					}
+					bool equivalent = AnalyzePair(functions[*iter],functions2[*iter],code,*contex_ptr,context_manager,k,p);
+					if (!call_summaries)
+						continue;
+					// a difference computed under the optimistic summaries of a recursive component is not sound
+					if (recursive)
+						TransferFuncs::call_differences_.erase(*iter);
+					cerr << "Summary of " << *iter << ": " << (equivalent ? "equivalent" : "may differ");
+					map<string,pair<double,double> >::const_iterator difference = TransferFuncs::call_differences_.find(*iter);
+					if (difference != TransferFuncs::call_differences_.end())
+						cerr << ", " << difference->second.first << " <= ret' - ret <= " << difference->second.second;
+					cerr << ".\n";
+					if (recursive && !equivalent && TransferFuncs::call_summaries_[*iter])
+						changed = true;
+					TransferFuncs::call_summaries_[*iter] = equivalent;
+				}
+			}
 		}
     }
 
@@ -5,6 +5,9 @@
 #include <iostream>
 #include <iterator>
 #include <vector>
+#include <map>
+#include <set>
+#include <stdint.h>
 using namespace std;
 #include <clang/Analysis/Analyses/LiveVariables.h>
 #include <clang/Analysis/Analyses/ReachableCode.h>
@@ -21,6 +24,19 @@ class IterativeAnalyzer
 private:
 	AnalyzerOptions analyzer_options_;
 
+	// change impact: the functions whose analysis may differ between the versions
+	static uint64_t HashTokens(const FunctionDecl * fd, ASTContext &contex);
+	static uint64_t HashOutsideFunctions(const map<string,const FunctionDecl*> &functions, ASTContext &contex);
+	static void CollectCallees(const Stmt * stmt, set<string> &callees);
+	static void AddCalls(const map<string,const FunctionDecl*> &functions, map<string,set<string> > &calls);
+	static set<string> ImpactedFunctions(const map<string,const FunctionDecl*> &functions, ASTContext &contex,
+			const map<string,const FunctionDecl*> &functions2, ASTContext &contex2, const map<string,set<string> > &calls);
+	// the strongly connected components of the call graph over the given functions, callees first
+	static vector<vector<string> > CallGraphSCCs(const set<string> &names, const map<string,set<string> > &calls);
+
+	bool AnalyzePair(const FunctionDecl * fd, const FunctionDecl * fd2, CodeHandler &code, ASTContext &contex,
+			AnalysisContextManager &context_manager, int k, int p);
+
 public:
 	IterativeAnalyzer();
 	~IterativeAnalyzer() { }
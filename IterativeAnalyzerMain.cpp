@@ -13,12 +13,24 @@ llvm::cl::list<string> IncludeDirs("I", llvm::cl::value_desc("directory"), llvm:
 llvm::cl::opt<string>  InputFilename(llvm::cl::Positional, llvm::cl::desc("filename"), llvm::cl::Optional);
 llvm::cl::opt<string>  InputFilename2(llvm::cl::Positional, llvm::cl::desc("2nd-filename"), llvm::cl::Optional);
 llvm::cl::list<string> ManagerType("m",llvm::cl::value_desc(differential::AnalysisConfiguration::kManagerTypes),llvm::cl::desc("Type of constraint manager for apron"));
+llvm::cl::list<string> VariablePacking("pack",llvm::cl::value_desc("flag"),llvm::cl::desc("Answer equivalence queries pack by pack (variables grouped by syntactic dependency)"));
+llvm::cl::list<string> ArrayIndexPool("arr_pool",llvm::cl::value_desc("positive integer"),llvm::cl::desc("Number of index variables per array (reused across access locations)"));
+llvm::cl::list<string> LivenessProjection("live",llvm::cl::value_desc("flag"),llvm::cl::desc("Remove variables that are dead in their version from the state at block boundaries"));
+llvm::cl::list<string> WarmStart("warm",llvm::cl::value_desc("directory"),llvm::cl::desc("Start from (and store) the fixpoints of functions analyzed before with the same body and configuration"));
 llvm::cl::list<string> PartitionPoint("p_p",llvm::cl::value_desc(differential::AnalysisConfiguration::kPartitionPoints),llvm::cl::desc("Partition point"));
 llvm::cl::list<string> PartitionStrategy("p_s",llvm::cl::value_desc(differential::AnalysisConfiguration::kPartitionStrategies),llvm::cl::desc("Partition strategy"));
 llvm::cl::list<string> WideningPoint("w_p",llvm::cl::value_desc(differential::AnalysisConfiguration::kWideningPoints),llvm::cl::desc("Widening point"));
 llvm::cl::list<string> WideningStrategy("w_s",llvm::cl::value_desc(differential::AnalysisConfiguration::kWideningStrategies),llvm::cl::desc("Widening strategies"));
 llvm::cl::list<string> WideningThreshold("w_t",llvm::cl::value_desc("positive integer"),llvm::cl::desc("Widening threshold"));
 llvm::cl::list<string> InterleavingLookaheadWindow("k",llvm::cl::value_desc("positive integer"),llvm::cl::desc("Speculative lookahead window size"));
+llvm::cl::list<string> AdaptiveLookahead("k_adapt",llvm::cl::value_desc("flag"),llvm::cl::desc("Adapt the lookahead window (up to k_max) to how much the speculations differ"));
+llvm::cl::list<string> LookaheadCap("k_max",llvm::cl::value_desc("positive integer"),llvm::cl::desc("Largest lookahead window the adaptive window may grow to, even past k (default and at most 20)"));
+llvm::cl::list<string> LookaheadTimeBudget("k_budget",llvm::cl::value_desc("seconds"),llvm::cl::desc("Wall time budget per function, after which the lookahead window is reduced to 1"));
+llvm::cl::list<string> Lockstep("lockstep",llvm::cl::value_desc("flag"),llvm::cl::desc("Advance both versions together over blocks the syntactic diff matched, speculate elsewhere"));
+llvm::cl::list<string> ObservableCallees("observe",llvm::cl::value_desc("functions"),llvm::cl::desc("Comma separated functions whose call sites are reported (default: printf)"));
+llvm::cl::list<string> ReportPairs("report_pairs",llvm::cl::value_desc("pairs"),llvm::cl::desc("Comma separated block ID pairs (first:second, or exit) to compute and report deltas at (default: exit and observable pairs)"));
+llvm::cl::list<string> ChangeImpact("impact",llvm::cl::value_desc("flag"),llvm::cl::desc("Only analyze functions that changed or (transitively) call a changed function"));
+llvm::cl::list<string> CallSummaries("summaries",llvm::cl::value_desc("flag"),llvm::cl::desc("Analyze callees first (bottom-up) and apply summaries at call sites: with equal arguments and globals, a callee proven equivalent gives equal results, otherwise the results differ at most by the bounds found at its exit and the globals it refers to are forgotten"));
 llvm::cl::list<string> InterleavingLookaheadPartition("p",llvm::cl::value_desc("positive integer"),llvm::cl::desc("Speculative partition interval"));
 
 int main(int argc, char* argv[])
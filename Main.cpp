@@ -3,6 +3,7 @@
 #include "UnionCompiler.h"
 using namespace differential;
 
+#include <ctime>
 #include <iostream>
 #include <iomanip>
 #include <fstream>
@@ -35,7 +36,12 @@ llvm::cl::list<string> RetGuard("ret_guard", llvm::cl::value_desc("flag"), llvm:
 
 // Analysis Flags:
 llvm::cl::list<string> ManagerType("m",llvm::cl::value_desc(differential::AnalysisConfiguration::kManagerTypes),llvm::cl::desc("Type of constraint manager for apron"));
+llvm::cl::list<string> CascadeManagerType("m_c",llvm::cl::value_desc(differential::AnalysisConfiguration::kManagerTypes),llvm::cl::desc("Re-analyze with this manager where the one given by -m can not prove equivalence"));
 llvm::cl::list<string> ComputeDiff("diff",llvm::cl::value_desc("flag"),llvm::cl::desc("Compute diff over all states (instead of just showing offendifng states)"));
+llvm::cl::list<string> ReportLines("report_lines",llvm::cl::value_desc("lines"),llvm::cl::desc("Comma separated lines of the correlation points to compute and report deltas at (default: all)"));
+llvm::cl::list<string> VariablePacking("pack",llvm::cl::value_desc("flag"),llvm::cl::desc("Answer equivalence queries pack by pack (variables grouped by syntactic dependency)"));
+llvm::cl::list<string> ArrayIndexPool("arr_pool",llvm::cl::value_desc("positive integer"),llvm::cl::desc("Number of index variables per array (reused across access locations)"));
+llvm::cl::list<string> WarmStart("warm",llvm::cl::value_desc("directory"),llvm::cl::desc("Start from (and store) the fixpoints of functions analyzed before with the same body and configuration"));
 llvm::cl::list<string> PartitionPoint("p_p",llvm::cl::value_desc(differential::AnalysisConfiguration::kPartitionPoints),llvm::cl::desc("Partition Point"));
 llvm::cl::list<string> PartitionStrategy("p_s",llvm::cl::value_desc(differential::AnalysisConfiguration::kPartitionStrategies),llvm::cl::desc("Partition Strategy"));
 llvm::cl::list<string> WideningPoint("w_p",llvm::cl::value_desc(differential::AnalysisConfiguration::kWideningPoints),llvm::cl::desc("Widening Point"));
@@ -46,6 +52,13 @@ llvm::cl::list<string> WideningThreshold("w_t",llvm::cl::value_desc("positive in
 llvm::cl::list<string> ReportFilename("r",llvm::cl::value_desc("report filename"),llvm::cl::desc("Filename for outputing the statistics when running with -c"));
 
 
+// prints the time the stage took since start, and returns the time it ended
+static clock_t StageTime(const char * stage, clock_t start) {
+    clock_t end = clock();
+    cout << "Stage " << stage << " took " << double(end - start) / CLOCKS_PER_SEC << " seconds.\n";
+    return end;
+}
+
 int main(int argc, char* argv[]) {
     CodeHandler::Init(argc,argv);
 
@@ -75,42 +88,42 @@ int main(int argc, char* argv[]) {
     " | ";
 
     string filename = InputFilename, patched_filname = PatchedFilename[0];
-    // Start by guarding both files
-
-    GuardFilename.addValue(filename);
-    cout << "GuardFilename = " << GuardFilename[0] << endl;
-    InputFilename = GuardFilename[0];
+    // the guarded., tagged. and union. files are kept in memory, each stage parses the buffers of the previous one
+    Utils::keep_in_memory_ = true;
+    clock_t start = clock();
+
+    // Start by guarding both files (as ccc -g and ccc -g_t do, the definitions are added first)
+    InputFilename = filename;
+    cout << "GuardFilename = " << InputFilename << endl;
+    UnionCompiler().AddDefinitions(); // InputFilename is now guarded.filename
     UnionCompiler().GuardedInstructionsTransform();
-    // Ignore this option from now own (the condition is size() == 1)
-    GuardFilename.addValue("");
 
-    GuardTaggedFilename.addValue(patched_filname);
-    cout << "GuardTaggedFilename = " << GuardTaggedFilename[0] << endl;
-    InputFilename = GuardTaggedFilename[0];
+    InputFilename = patched_filname;
+    cout << "GuardTaggedFilename = " << InputFilename << endl;
+    UnionCompiler().AddDefinitions();
     UnionCompiler().GuardedInstructionsTransform();
-    // Ignore this option from now own (the condition is size() == 1)
-    GuardTaggedFilename.addValue("");
+    start = StageTime("guard",start);
 
     // Now tag the patched file
-    TagFilename.addValue(Defines::kGuardedFilenamePrefix + patched_filname);
-    cout << "TagFilename = " << TagFilename[0] << endl;
-    InputFilename = TagFilename[0];
+    InputFilename = Defines::kGuardedFilenamePrefix + patched_filname;
+    cout << "TagFilename = " << InputFilename << endl;
     UnionCompiler().TagInstructionsTransform();
-    // Ignore this option from now own (the condition is size() == 1)
-    TagFilename.addValue("");
+    start = StageTime("tag",start);
 
     // Now union the files
     InputFilename.setValue(Defines::kGuardedFilenamePrefix + filename);
     PatchedFilename[0] = Defines::kTaggedFilenamePrefix + Defines::kGuardedFilenamePrefix + patched_filname;
     cout << "InputFilename = " << InputFilename << ",PatchedFilename = " << PatchedFilename[0] << endl;
     UnionCompiler().UnionTransform(report_file);
-    // Ignore this option from now own (the condition is size() == 1)
-    PatchedFilename.addValue("");
+    start = StageTime("union",start);
 
-    // Now analyze it
+    // Now analyze it (the results are written out)
+    Utils::keep_in_memory_ = false;
     InputFilename.setValue(Defines::kUnionedFilenamePrefix + filename);
     cout << "InputFilename = " << InputFilename << endl;
     Analyzer().RunAnalysis(report_file);
+    StageTime("analyze",start);
+    Utils::memory_files_.clear();
 
     report_file << setw(15) <<" |\n";
     report_file.close();
@@ -0,0 +1,23 @@
+#!/bin/bash
+echo "Usage: dbm-oct.sh filename [timeout seconds]"
+if [[ $1 == "" ]] # No filename given, exit
+    then
+        echo "No filename given, exiting"
+        exit
+fi
+# Analyzes the same (union) file with the DBM domain and with octagons.
+# DBMs only keep x - y <= c so their deltas may be coarser, but they must
+# terminate wherever the octagon analysis does.
+seconds=${2:-600}
+for manager in dbm oct
+    do
+        echo "Analyzing...(dizy $1 -m=$manager -diff=true > analysis.$manager.$1.out 2> analysis.$manager.$1.err)"
+        timeout $seconds dizy $1 -m=$manager -diff=true > analysis.$manager.$1.out 2> analysis.$manager.$1.err
+        if [[ $? == 124 ]]
+            then
+                echo "$manager did not terminate within $seconds seconds"
+        fi
+    done
+echo "Comparing...(diff analysis.dbm.$1.out analysis.oct.$1.out)"
+diff <(grep -v "^Domain: " analysis.dbm.$1.out) <(grep -v "^Domain: " analysis.oct.$1.out)
+echo "$1 Done"
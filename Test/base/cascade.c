@@ -0,0 +1,18 @@
+int cascade(int a, int b, int c, int d, int e, int f, int g) {
+  int x = 0;
+  if (a > 0)
+    x = x + 1;
+  if (b > 0)
+    x = x + 2;
+  if (c > 0)
+    x = x + 4;
+  if (d > 0)
+    x = x + 8;
+  if (e > 0)
+    x = x + 16;
+  if (f > 0)
+    x = x + 32;
+  if (g > 0)
+    x = x + 64;
+  return x;
+}
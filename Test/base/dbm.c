@@ -0,0 +1,13 @@
+int dbm(int x, int y, int n) {
+  int i = 0;
+  int z;
+  if (x <= y)
+    z = y + 1;
+  else
+    z = x + 1;
+  while (i < n) {
+    z = z + 1;
+    i = i + 1;
+  }
+  return z - i;
+}
@@ -0,0 +1,11 @@
+int dbm(int x, int y, int n) {
+  int i = 0;
+  int z;
+  if (x < y)
+    z = y + 1;
+  else
+    z = x + 1;
+  for (i = 0; i < n; i++)
+    z = z + 1;
+  return z - i;
+}
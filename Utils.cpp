@@ -1,5 +1,6 @@
 #include <clang/Basic/FileManager.h>
 #include <clang/Basic/SourceManager.h>
+#include <clang/AST/Expr.h>
 #include <llvm/Support/raw_ostream.h>
 #include "Utils.h"
 #include "Defines.h"
@@ -13,6 +14,8 @@ using namespace std;
 
 namespace differential {
 
+bool Utils::keep_in_memory_ = false;
+map<string,string> Utils::memory_files_;
 
 /**
  * extract all function declarations from the translation units and populate them into a 'function_name' -> 'function_decl_ptr' map given as argument
@@ -28,6 +31,27 @@ void Utils::CreateFunctionsMap(TranslationUnitDecl * tran_unit_ptr,map<string,co
 	}
 }
 
+/**
+ * collect the variables referenced or declared (with their initializers) in the statement, in order of appearance
+ */
+void Utils::CollectVarDecls(const Stmt * stmt, vector<const VarDecl *> &decls) {
+	if (!stmt)
+		return;
+	if (const DeclRefExpr * ref = dyn_cast<DeclRefExpr>(stmt)) {
+		if (const VarDecl * decl = dyn_cast<VarDecl>(ref->getDecl()))
+			decls.push_back(decl);
+	} else if (const DeclStmt * decl_stmt = dyn_cast<DeclStmt>(stmt)) {
+		for (DeclStmt::const_decl_iterator iter = decl_stmt->decl_begin(), end = decl_stmt->decl_end(); iter != end; ++iter) {
+			if (const VarDecl * decl = dyn_cast<VarDecl>(*iter)) {
+				decls.push_back(decl);
+				CollectVarDecls(decl->getInit(),decls);
+			}
+		}
+	}
+	for (Stmt::const_child_iterator iter = stmt->child_begin(), end = stmt->child_end(); iter != end; ++iter)
+		CollectVarDecls(*iter,decls);
+}
+
 size_t Utils::GetStmtLength(Stmt * node) {
 	return node->getSourceRange().getEnd().getRawEncoding() - node->getSourceRange().getBegin().getRawEncoding() + 2; // +2 correcting for clang
 }
@@ -171,6 +195,13 @@ void Utils::WriteFiles(Rewriter& rw, string filename)
 		const FileEntry *Entry = rw.getSourceMgr().getFileEntryForID(I->first);
 		if (filename == "")
 			filename = Entry->getName();
+		if (keep_in_memory_) { // the next stage of the pipeline parses it from memory
+			string contents;
+			raw_string_ostream OS(contents);
+			I->second.write(OS);
+			memory_files_[filename] = OS.str();
+			continue;
+		}
 		string error;
 		raw_fd_ostream OS(filename.c_str(), error, raw_fd_ostream::F_Binary);
 		if (!error.empty()) {
@@ -21,7 +21,11 @@ namespace differential {
 
 		public:
 
+		static bool keep_in_memory_; // WriteFiles keeps the files in memory_files_ instead of writing them out
+		static map<string,string> memory_files_; // filename -> contents, opened by CodeHandler instead of the file on disk
+
 		static void CreateFunctionsMap(TranslationUnitDecl * tran_unit_ptr, map<string,const FunctionDecl *> &functions);
+		static void CollectVarDecls(const Stmt * stmt, vector<const VarDecl *> &decls);
         static size_t GetStmtLength(Stmt *node);
         static size_t GetDeclLength(Decl *node);
         static string PrintStmt(Stmt *node, ASTContext &contex);